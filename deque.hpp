@@ -1,5 +1,37 @@
+#pragma once
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <functional>
 #include <iostream>
+#include <memory_resource>
+#include <stdexcept>
 #include <string>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Execution tag for the bucket-parallel overloads of Deque. Work is split
+// at bucket boundaries; zero threads means hardware_concurrency().
+struct DequeParallel {
+  size_t threads = 0;
+};
+
+// Storage events of the deques it is attached to with set_growth_stats().
+// Plain counters: one instance should not be shared between threads.
+struct DequeGrowthStats {
+  size_t map_reallocations = 0;
+  size_t bucket_allocations = 0;
+  size_t bucket_deallocations = 0;
+};
 
 template <typename T, typename Allocator = std::allocator<T>>
 class Deque {
@@ -20,6 +52,12 @@ class Deque {
 
   Allocator alloc_;
   bucket_alloc buck_alloc_;
+  DequeGrowthStats* stats_ = nullptr;
+
+  T* allocate_bucket();
+  void deallocate_bucket(T* bucket);
+  void grow_map(size_t front_buckets, size_t back_buckets);
+  void normalize_end();
 
   template <typename Iterator>
   void bucket_filler_with_iterator(size_t& cnt, Iterator iter);
@@ -30,74 +68,112 @@ class Deque {
   void bucket_deallocator(size_t until, size_t head, size_t end);
 
   void my_swap(Deque& other);
+  void swap_allocators(Deque& other);
 
   template <typename... Args>
   void memory_helper(Args&&... args, bool is_end);
 
-  struct IsCopyAssigned {
-    bool value = false;
+  // Layout of the snapshot written by write_to(). Element bytes follow
+  // the header, front to back, with no padding between buckets.
+  struct SnapshotHeader {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t element_size;
+    uint64_t size;
+    uint64_t checksum;
+  };
+
+  static constexpr uint64_t kSnapshotMagic = 0x5155454445515344ull;
+  static constexpr uint32_t kSnapshotVersion = 1;
+
+  // Streaming 64-bit checksum, independent of how the bytes are split
+  // into chunks, so writer and reader may walk different bucket layouts.
+  struct SnapshotChecksum {
+    uint64_t hash = 14695981039346656037ull;
+    uint64_t pending = 0;
+    size_t pending_bytes = 0;
 
-    IsCopyAssigned(bool value) : value(value) {}
+    void update(const void* data, size_t bytes);
+    uint64_t finish() const;
   };
 
+  template <typename Func>
+  void for_each_segment(Func func) const;
+
+  void reset_storage(size_t count);
+
+  // Appends 'count' elements read as raw bytes: read(iov, iov_count) fills
+  // the given runs of cells and returns false on a short read.
+  template <typename Read>
+  void append_raw(size_t count, Read read);
+
+  SnapshotHeader snapshot_header() const;
+  void check_snapshot_header(const SnapshotHeader& header) const;
+
+  static void transfer_all(int fd, iovec* iov, size_t count, bool writing);
+
+  std::vector<size_t> chunk_bounds(size_t threads) const;
+
+  template <typename Task>
+  static void run_tasks(size_t count, Task task);
+
+  template <typename Construct>
+  void parallel_construct(const DequeParallel& policy, Construct construct);
+
  public:
-  Deque() : arr_(bucket_alloc_traits::allocate(buck_alloc_, 1)), ptr_cnt_(1) {
-    arr_[0] = alloc_traits::allocate(alloc_, kBucketSize);
+  using value_type = T;
+  using allocator_type = Allocator;
+
+  // The map is allocated in the bodies: allocators are declared after
+  // arr_, so they are not constructed yet in the initializer lists.
+  Deque() : ptr_cnt_(1) {
+    arr_ = bucket_alloc_traits::allocate(buck_alloc_, 1);
+    arr_[0] = allocate_bucket();
   }
 
   Deque(const Allocator& alloc)
-      : arr_(bucket_alloc_traits::allocate(buck_alloc_, 1)),
-        ptr_cnt_(1),
-        alloc_(alloc),
-        buck_alloc_(alloc) {
-    arr_[0] = alloc_traits::allocate(alloc_, kBucketSize);
+      : ptr_cnt_(1), alloc_(alloc), buck_alloc_(alloc) {
+    arr_ = bucket_alloc_traits::allocate(buck_alloc_, 1);
+    arr_[0] = allocate_bucket();
   }
 
-  Deque(const Deque& other, const IsCopyAssigned& flag)
-      : arr_(bucket_alloc_traits::allocate(buck_alloc_, other.ptr_cnt_)),
-        size_(other.size_),
+  // Allocator-extended copy constructor; also the building block of copy
+  // assignment, which picks the allocator by the propagation traits.
+  Deque(const Deque& other, const Allocator& alloc)
+      : size_(other.size_),
         ptr_cnt_(other.ptr_cnt_),
         head_bucket_(other.head_bucket_),
         head_cell_(other.head_cell_),
         end_bucket_(other.end_bucket_),
-        end_cell_(other.end_cell_) {
-    // Code of copy constructor can be useful for purposes of
-    // copy assignment operator, therefore flag is used.
-    if (flag.value &&
-        alloc_traits::propagate_on_container_copy_assignment::value) {
-      alloc_ = other.alloc_;
-      if (bucket_alloc_traits::propagate_on_container_copy_assignment::value) {
-        buck_alloc_ = other.buck_alloc_;
-      }
-    } else {
-      alloc_ =
-          alloc_traits::select_on_container_copy_construction(other.alloc_);
-      buck_alloc_ = bucket_alloc_traits::select_on_container_copy_construction(
-          other.buck_alloc_);
-    }
-    size_t bucket_cord = 0;
-    size_t cell_cord = 0;
+        end_cell_(other.end_cell_),
+        alloc_(alloc),
+        buck_alloc_(alloc) {
+    arr_ = bucket_alloc_traits::allocate(buck_alloc_, ptr_cnt_);
+    size_t allocated = 0;
     size_t cnt = 0;
     try {
-      for (size_t i = 0; i < ptr_cnt_; ++i) {
-        arr_[i] = alloc_traits::allocate(alloc_, kBucketSize);
+      for (; allocated < ptr_cnt_; ++allocated) {
+        arr_[allocated] = allocate_bucket();
       }
       const_iterator iter = other.begin();
       bucket_filler_with_iterator(cnt, iter);
     } catch (...) {
-      bucket_deallocator(cnt, 0, ptr_cnt_ - 1);
-      size_ = 0;
-      ptr_cnt_ = 0;
-      head_bucket_ = 0;
-      head_cell_ = 0;
-      end_bucket_ = 0;
-      end_cell_ = -1;
-      alloc_ = Allocator();
+      if (allocated == ptr_cnt_) {
+        bucket_deallocator(cnt, 0, ptr_cnt_ - 1);
+      } else {
+        for (size_t i = 0; i < allocated; ++i) {
+          deallocate_bucket(arr_[i]);
+        }
+        bucket_alloc_traits::deallocate(buck_alloc_, arr_, ptr_cnt_);
+      }
       throw;
     }
   }
 
-  Deque(const Deque& other) : Deque(other, IsCopyAssigned(false)) {}
+  Deque(const Deque& other)
+      : Deque(other,
+              alloc_traits::select_on_container_copy_construction(
+                  other.alloc_)) {}
 
   Deque(size_t count, const Allocator& alloc = Allocator())
       : size_(count), alloc_(alloc), buck_alloc_(alloc) {
@@ -108,7 +184,6 @@ class Deque {
     } catch (...) {
       bucket_deallocator(cnt, 0, ptr_cnt_ - 1);
       size_ = 0;
-      alloc_ = Allocator();
       throw;
     }
     end_bucket_ = (size_ - 1) / kBucketSize;
@@ -124,28 +199,54 @@ class Deque {
     } catch (...) {
       bucket_deallocator(cnt, 0, ptr_cnt_ - 1);
       size_ = 0;
-      alloc_ = Allocator();
       throw;
     }
     end_bucket_ = (size_ - 1) / kBucketSize;
     end_cell_ = (size_ - 1) % kBucketSize;
   }
 
+  Deque(const DequeParallel& policy, size_t count,
+        const Allocator& alloc = Allocator())
+      : Deque(alloc) {
+    reset_storage(count);
+    parallel_construct(policy, [this](T* ptr, size_t) {
+      alloc_traits::construct(alloc_, ptr);
+    });
+  }
+
+  Deque(const DequeParallel& policy, size_t count, const T& value,
+        const Allocator& alloc = Allocator())
+      : Deque(alloc) {
+    reset_storage(count);
+    parallel_construct(policy, [this, &value](T* ptr, size_t) {
+      alloc_traits::construct(alloc_, ptr, value);
+    });
+  }
+
+  Deque(const DequeParallel& policy, const Deque& other)
+      : Deque(alloc_traits::select_on_container_copy_construction(
+            other.alloc_)) {
+    reset_storage(other.size_);
+    parallel_construct(policy, [this, &other](T* ptr, size_t index) {
+      alloc_traits::construct(alloc_, ptr, other[index]);
+    });
+  }
+
   Deque(Deque&& other)
       : arr_(other.arr_),
-        ptr_cnt_(other.ptr_cnt_),
         size_(other.size_),
+        ptr_cnt_(other.ptr_cnt_),
         head_bucket_(other.head_bucket_),
         head_cell_(other.head_cell_),
         end_bucket_(other.end_bucket_),
         end_cell_(other.end_cell_),
         alloc_(std::move(other.alloc_)),
         buck_alloc_(std::move(other.buck_alloc_)) {
-    other.buck_alloc_ = bucket_alloc();
-    other.alloc_ = Allocator();
+    // The moved-from deque keeps a copy of the allocator, so that its
+    // fresh bucket comes from the same resource.
     other.arr_ = bucket_alloc_traits::allocate(other.buck_alloc_, 1);
     other.ptr_cnt_ = 1;
-    other.arr_[0] = alloc_traits::allocate(other.alloc_, kBucketSize);
+    other.arr_[0] = other.allocate_bucket();
     other.size_ = 0;
     other.head_bucket_ = 0;
     other.head_cell_ = 0;
@@ -163,22 +264,42 @@ class Deque {
     } catch (...) {
       bucket_deallocator(cnt, 0, ptr_cnt_ - 1);
       size_ = 0;
-      alloc_ = Allocator();
       throw;
     }
     end_bucket_ = (size_ - 1) / kBucketSize;
     end_cell_ = (size_ - 1) % kBucketSize;
   }
 
+  // Allocators that do not propagate are never assigned, which is what
+  // makes std::pmr::polymorphic_allocator usable here.
   Deque& operator=(const Deque& other) {
-    Deque copy(other, IsCopyAssigned(true));
-    my_swap(copy);
+    if constexpr (alloc_traits::propagate_on_container_copy_assignment::value) {
+      Deque copy(other, other.alloc_);
+      my_swap(copy);
+      swap_allocators(copy);
+    } else {
+      Deque copy(other, alloc_);
+      my_swap(copy);
+    }
     return *this;
   }
 
   Deque& operator=(Deque&& other) {
-    Deque copy = std::move(other);
-    my_swap(copy);
+    if constexpr (alloc_traits::propagate_on_container_move_assignment::value) {
+      Deque copy = std::move(other);
+      my_swap(copy);
+      swap_allocators(copy);
+    } else if (alloc_ == other.alloc_) {
+      Deque copy = std::move(other);
+      my_swap(copy);
+    } else {
+      // Storage from another resource cannot be adopted: move elementwise.
+      Deque copy(alloc_);
+      for (T& value : other) {
+        copy.emplace_back(std::move(value));
+      }
+      my_swap(copy);
+    }
     return *this;
   }
 
@@ -284,13 +405,82 @@ class Deque {
   void pop_front() {
     T* ptr = arr_[head_bucket_] + head_cell_;
     alloc_traits::destroy(alloc_, ptr);
-    head_bucket_ = (++head_cell_) / kBucketSize;
+    head_bucket_ += (++head_cell_) / kBucketSize;
     head_cell_ %= kBucketSize;
     --size_;
   }
 
   Allocator get_allocator() const { return alloc_; }
 
+  // Elements that can be pushed at either end before the map is rebuilt.
+  size_t capacity_front() const {
+    return head_bucket_ * kBucketSize + head_cell_;
+  }
+
+  size_t capacity_back() const {
+    return ptr_cnt_ * kBucketSize - capacity_front() - size_;
+  }
+
+  size_t bucket_count() const { return ptr_cnt_; }
+
+  size_t max_size() const { return alloc_traits::max_size(alloc_); }
+
+  // Bytes held in buckets and in the map, whether in use or not.
+  size_t allocated_bytes() const {
+    return ptr_cnt_ * (kBucketSize * sizeof(T) + sizeof(T*));
+  }
+
+  size_t slack_bytes() const { return allocated_bytes() - size_ * sizeof(T); }
+
+  void reserve_front(size_t count) {
+    if (capacity_front() < count) {
+      grow_map((count - capacity_front() + kBucketSize - 1) / kBucketSize, 0);
+    }
+  }
+
+  void reserve_back(size_t count) {
+    if (capacity_back() < count) {
+      grow_map(0, (count - capacity_back() + kBucketSize - 1) / kBucketSize);
+    }
+  }
+
+  // Counts this deque's storage events into 'stats' from now on; nullptr
+  // detaches. Not transferred by copy, move or swap.
+  void set_growth_stats(DequeGrowthStats* stats) { stats_ = stats; }
+
+  // Binary snapshot of the deque. Requires trivially copyable T: buckets
+  // are written and read as raw bytes with vectored I/O.
+  void write_to(int fd) const;
+  void write_to(std::ostream& out) const;
+
+  // Replaces contents with a snapshot produced by write_to(). Throws
+  // std::runtime_error on malformed, truncated or corrupted input and
+  // leaves the deque unchanged in that case.
+  void read_from(int fd);
+  void read_from(std::istream& in);
+
+  // Calls func(first, last) for every contiguous run of elements, with
+  // consecutive buckets handed to the same thread.
+  template <typename Func>
+  void parallel_for_each_bucket(const DequeParallel& policy, Func func);
+
+  void fill(const DequeParallel& policy, const T& value) {
+    parallel_for_each_bucket(policy, [&value](T* first, T* last) {
+      std::fill(first, last, value);
+    });
+  }
+
+  template <typename UnaryOp>
+  void transform(const DequeParallel& policy, UnaryOp op) {
+    parallel_for_each_bucket(policy, [&op](T* first, T* last) {
+      std::transform(first, last, first, op);
+    });
+  }
+
+  // Sorts bucket-aligned segments in parallel, then merges them pairwise.
+  template <typename Compare = std::less<T>>
+  void sort(const DequeParallel& policy, Compare comp = Compare());
+
   template <bool IsConst>
   struct PreIterator {
    private:
@@ -481,6 +671,14 @@ class Deque {
   ~Deque() { bucket_deallocator(size_, 0, ptr_cnt_ - 1); }
 };
 
+// Deque drawing its buckets from a std::pmr::memory_resource. Backed by a
+// std::pmr::monotonic_buffer_resource, buckets are carved out of large
+// slabs in allocation order and all of them go back in one release() of
+// the resource; deques of trivially destructible T that live in such a
+// resource may simply be dropped with it.
+template <typename T>
+using PmrDeque = Deque<T, std::pmr::polymorphic_allocator<T>>;
+
 template <typename T, typename Allocator>
 template <typename Iterator>
 void Deque<T, Allocator>::bucket_filler_with_iterator(size_t& cnt,
@@ -510,12 +708,72 @@ void Deque<T, Allocator>::bucket_filler(size_t& cnt) {
   }
 }
 
+template <typename T, typename Allocator>
+T* Deque<T, Allocator>::allocate_bucket() {
+  T* bucket = alloc_traits::allocate(alloc_, kBucketSize);
+  if (stats_ != nullptr) {
+    ++stats_->bucket_allocations;
+  }
+  return bucket;
+}
+
+template <typename T, typename Allocator>
+void Deque<T, Allocator>::deallocate_bucket(T* bucket) {
+  alloc_traits::deallocate(alloc_, bucket, kBucketSize);
+  if (stats_ != nullptr) {
+    ++stats_->bucket_deallocations;
+  }
+}
+
+template <typename T, typename Allocator>
+void Deque<T, Allocator>::normalize_end() {
+  // A fresh deque marks its end as cell -1 of bucket 0. Once buckets are
+  // added in front that must become the last cell of the previous bucket,
+  // which is what pop_back() and the 'used' bucket count expect.
+  if (end_cell_ == static_cast<size_t>(-1)) {
+    --end_bucket_;
+    end_cell_ = kBucketSize - 1;
+  }
+}
+
+template <typename T, typename Allocator>
+void Deque<T, Allocator>::grow_map(size_t front_buckets,
+                                   size_t back_buckets) {
+  normalize_end();
+  size_t new_cnt = front_buckets + ptr_cnt_ + back_buckets;
+  T** tmp_arr = bucket_alloc_traits::allocate(buck_alloc_, new_cnt);
+  size_t allocated = 0;
+  try {
+    for (; allocated < front_buckets; ++allocated) {
+      tmp_arr[allocated] = allocate_bucket();
+    }
+    for (; allocated < front_buckets + back_buckets; ++allocated) {
+      tmp_arr[ptr_cnt_ + allocated] = allocate_bucket();
+    }
+  } catch (...) {
+    for (size_t i = 0; i < allocated; ++i) {
+      deallocate_bucket(tmp_arr[i < front_buckets ? i : ptr_cnt_ + i]);
+    }
+    bucket_alloc_traits::deallocate(buck_alloc_, tmp_arr, new_cnt);
+    throw;
+  }
+  std::copy(arr_, arr_ + ptr_cnt_, tmp_arr + front_buckets);
+  bucket_alloc_traits::deallocate(buck_alloc_, arr_, ptr_cnt_);
+  arr_ = tmp_arr;
+  ptr_cnt_ = new_cnt;
+  head_bucket_ += front_buckets;
+  end_bucket_ += front_buckets;
+  if (stats_ != nullptr) {
+    ++stats_->map_reallocations;
+  }
+}
+
 template <typename T, typename Allocator>
 void Deque<T, Allocator>::bucket_allocator(size_t count) {
   ptr_cnt_ = (count + kBucketSize - 1) / kBucketSize;
   arr_ = bucket_alloc_traits::allocate(buck_alloc_, ptr_cnt_);
   for (size_t i = 0; i < ptr_cnt_; ++i) {
-    arr_[i] = alloc_traits::allocate(alloc_, kBucketSize);
+    arr_[i] = allocate_bucket();
   }
 }
 
@@ -529,7 +787,7 @@ void Deque<T, Allocator>::bucket_deallocator(size_t until, size_t head,
   }
   if (ptr_cnt_ != 0) {
     for (size_t i = head; i <= end; ++i) {
-      alloc_traits::deallocate(alloc_, arr_[i], kBucketSize);
+      deallocate_bucket(arr_[i]);
     }
   }
   bucket_alloc_traits::deallocate(buck_alloc_, arr_, ptr_cnt_);
@@ -544,6 +802,10 @@ void Deque<T, Allocator>::my_swap(Deque& other) {
   std::swap(head_cell_, other.head_cell_);
   std::swap(end_bucket_, other.end_bucket_);
   std::swap(end_cell_, other.end_cell_);
+}
+
+template <typename T, typename Allocator>
+void Deque<T, Allocator>::swap_allocators(Deque& other) {
   std::swap(alloc_, other.alloc_);
   std::swap(buck_alloc_, other.buck_alloc_);
 }
@@ -551,54 +813,75 @@ void Deque<T, Allocator>::my_swap(Deque& other) {
 template <typename T, typename Allocator>
 template <typename... Args>
 void Deque<T, Allocator>::memory_helper(Args&&... args, bool is_end) {
-  size_t shift = 1 + ((2 * ptr_cnt_ - (end_bucket_ - head_bucket_ + 1)) / 2);
-  T** tmp_arr = bucket_alloc_traits::allocate(buck_alloc_, 2 * ptr_cnt_ + 1);
-  for (size_t i = 0; i < end_bucket_ - head_bucket_ + 1; ++i) {
-    tmp_arr[i + shift] = &*arr_[i + head_bucket_];
-  }
-  size_t old_end1 = end_bucket_;
-  size_t old_head1 = head_bucket_;
-  end_bucket_ = (end_bucket_ - head_bucket_) + shift;
-  head_bucket_ = shift;
-  for (size_t i = 0; i < head_bucket_; ++i) {
-    tmp_arr[i] = alloc_traits::allocate(alloc_, kBucketSize);
-  }
-  for (size_t i = end_bucket_ + 1; i < 2 * ptr_cnt_ + 1; ++i) {
-    tmp_arr[i] = alloc_traits::allocate(alloc_, kBucketSize);
+  normalize_end();
+  size_t used = end_bucket_ - head_bucket_ + 1;
+  // When the deque is used as a queue, one end keeps running into the map
+  // edge while most buckets are free: recentre instead of doubling then.
+  size_t new_cnt =
+      (2 * (used + 2) <= ptr_cnt_) ? ptr_cnt_ : 2 * ptr_cnt_ + 1;
+  size_t shift = (new_cnt - used + 1) / 2;
+  T** tmp_arr = bucket_alloc_traits::allocate(buck_alloc_, new_cnt);
+  for (size_t i = 0; i < used; ++i) {
+    tmp_arr[i + shift] = arr_[i + head_bucket_];
   }
 
+  // Free slots are filled with the old spare buckets first, and only the
+  // rest is freshly allocated, so rollback frees exactly those.
+  size_t spare = 0;
+  auto next_spare = [&]() -> T* {
+    while (spare >= head_bucket_ && spare <= end_bucket_ && used != 0) {
+      ++spare;
+    }
+    return spare < ptr_cnt_ ? arr_[spare++] : nullptr;
+  };
+  size_t fresh_from = new_cnt;
+  size_t fresh_cnt = 0;
+  auto fill_slot = [&](size_t slot) {
+    T* bucket = next_spare();
+    if (bucket == nullptr) {
+      bucket = allocate_bucket();
+      fresh_from = std::min(fresh_from, slot);
+      ++fresh_cnt;
+    }
+    tmp_arr[slot] = bucket;
+  };
+  auto rollback = [&]() {
+    for (size_t slot = fresh_from; fresh_cnt != 0; ++slot) {
+      if (slot < shift || slot >= shift + used) {
+        deallocate_bucket(tmp_arr[slot]);
+        --fresh_cnt;
+      }
+    }
+    bucket_alloc_traits::deallocate(buck_alloc_, tmp_arr, new_cnt);
+  };
+
   // Choosing place to add, depending on 'is_end' bool argument.
-  size_t bucket_cord = is_end ? end_bucket_ + 1 : head_bucket_ - 1;
+  size_t bucket_cord = is_end ? shift + used : shift - 1;
   size_t cell_cord = is_end ? 0 : kBucketSize - 1;
-  T* where_to_construct = tmp_arr[bucket_cord] + cell_cord;
-
   try {
-    alloc_traits::construct(alloc_, where_to_construct,
-                            std::forward<Args>(args)...);
-  } catch (...) {
-    for (size_t i = 0; i < head_bucket_; ++i) {
-      alloc_traits::deallocate(alloc_, tmp_arr[i], kBucketSize);
+    for (size_t i = 0; i < shift; ++i) {
+      fill_slot(i);
     }
-    for (size_t i = end_bucket_ + 1; i < 2 * ptr_cnt_ + 1; ++i) {
-      alloc_traits::deallocate(alloc_, tmp_arr[i], kBucketSize);
+    for (size_t i = shift + used; i < new_cnt; ++i) {
+      fill_slot(i);
     }
-    bucket_alloc_traits::deallocate(buck_alloc_, tmp_arr, 2 * ptr_cnt_ + 1);
-    head_bucket_ = old_head1;
-    end_bucket_ = old_end1;
+    alloc_traits::construct(alloc_, tmp_arr[bucket_cord] + cell_cord,
+                            std::forward<Args>(args)...);
+  } catch (...) {
+    rollback();
     throw;
   }
-  for (size_t i = 0; i < old_head1; ++i) {
-    alloc_traits::deallocate(alloc_, arr_[i], kBucketSize);
-  }
-  for (size_t i = old_end1 + 1; i < ptr_cnt_; ++i) {
-    alloc_traits::deallocate(alloc_, arr_[i], kBucketSize);
-  }
   bucket_alloc_traits::deallocate(buck_alloc_, arr_, ptr_cnt_);
+  head_bucket_ = shift;
+  end_bucket_ = shift + used - 1;
   is_end ? (++end_bucket_, end_cell_ = 0)
          : (--head_bucket_, head_cell_ = kBucketSize - 1);
-  ++(ptr_cnt_ *= 2);
+  ptr_cnt_ = new_cnt;
   ++size_;
   arr_ = tmp_arr;
+  if (stats_ != nullptr) {
+    ++stats_->map_reallocations;
+  }
 }
 
 template <typename T, typename Allocator>
@@ -664,3 +947,388 @@ void Deque<T, Allocator>::erase(const_iterator iter) {
   end_bucket_ -= (end_cell_ + 1) / kBucketSize;
   --size_;
 }
+
+template <typename T, typename Allocator>
+void Deque<T, Allocator>::SnapshotChecksum::update(const void* data,
+                                                   size_t bytes) {
+  const unsigned char* ptr = static_cast<const unsigned char*>(data);
+  const uint64_t kPrime = 1099511628211ull;
+  while (pending_bytes != 0 && bytes != 0) {
+    pending |= static_cast<uint64_t>(*ptr++) << (8 * pending_bytes++);
+    --bytes;
+    if (pending_bytes == 8) {
+      hash = (hash ^ pending) * kPrime;
+      hash ^= hash >> 32;
+      pending = 0;
+      pending_bytes = 0;
+    }
+  }
+  for (; bytes >= 8; bytes -= 8, ptr += 8) {
+    uint64_t word;
+    std::memcpy(&word, ptr, 8);
+    hash = (hash ^ word) * kPrime;
+    hash ^= hash >> 32;
+  }
+  for (; bytes != 0; --bytes) {
+    pending |= static_cast<uint64_t>(*ptr++) << (8 * pending_bytes++);
+  }
+}
+
+template <typename T, typename Allocator>
+uint64_t Deque<T, Allocator>::SnapshotChecksum::finish() const {
+  // The tail and its length are folded in separately: xoring both into one
+  // step let a trailing value equal to its byte count cancel out.
+  const uint64_t kPrime = 1099511628211ull;
+  return (((hash ^ pending) * kPrime) ^ pending_bytes) * kPrime;
+}
+
+template <typename T, typename Allocator>
+template <typename Func>
+void Deque<T, Allocator>::for_each_segment(Func func) const {
+  // Walking by element count rather than by end_bucket_/end_cell_ keeps
+  // this correct for emptied deques, where the end cursor wraps around.
+  size_t bucket = head_bucket_;
+  size_t cell = head_cell_;
+  size_t left = size_;
+  while (left != 0) {
+    size_t count = std::min(kBucketSize - cell, left);
+    func(arr_[bucket] + cell, count);
+    left -= count;
+    ++bucket;
+    cell = 0;
+  }
+}
+
+template <typename T, typename Allocator>
+void Deque<T, Allocator>::reset_storage(size_t count) {
+  // Only used on freshly constructed empty deques: the new buckets are
+  // left uninitialized, and the caller must construct all count elements.
+  if (count > max_size()) {
+    throw std::length_error("Deque: too many elements");
+  }
+  size_t buckets = std::max<size_t>(
+      1, count / kBucketSize + (count % kBucketSize != 0));
+  T** tmp_arr = bucket_alloc_traits::allocate(buck_alloc_, buckets);
+  size_t allocated = 0;
+  try {
+    for (; allocated < buckets; ++allocated) {
+      tmp_arr[allocated] = allocate_bucket();
+    }
+  } catch (...) {
+    for (size_t i = 0; i < allocated; ++i) {
+      deallocate_bucket(tmp_arr[i]);
+    }
+    bucket_alloc_traits::deallocate(buck_alloc_, tmp_arr, buckets);
+    throw;
+  }
+  bucket_deallocator(size_, 0, ptr_cnt_ - 1);
+  arr_ = tmp_arr;
+  ptr_cnt_ = buckets;
+  size_ = count;
+  head_bucket_ = 0;
+  head_cell_ = 0;
+  end_bucket_ = count == 0 ? 0 : (count - 1) / kBucketSize;
+  end_cell_ = count == 0 ? -1 : (count - 1) % kBucketSize;
+}
+
+template <typename T, typename Allocator>
+template <typename Read>
+void Deque<T, Allocator>::append_raw(size_t count, Read read) {
+  // Storage grows with the data that has arrived, at most doubling per
+  // round, so a corrupt count ends in a short read rather than a huge
+  // allocation up front. The new cells are left uninitialized, so T must
+  // be trivially copyable.
+  std::vector<iovec> iov;
+  while (size_ < count) {
+    size_t step =
+        std::min(count - size_, std::max(size_, kBucketSize * kBucketSize));
+    reserve_back(step);
+    iov.clear();
+    for (size_t done = 0; done < step;) {
+      size_t position = head_cell_ + size_ + done;
+      size_t cell = position % kBucketSize;
+      size_t chunk = std::min(kBucketSize - cell, step - done);
+      iov.push_back(iovec{arr_[head_bucket_ + position / kBucketSize] + cell,
+                          chunk * sizeof(T)});
+      done += chunk;
+    }
+    if (!read(iov.data(), iov.size())) {
+      throw std::runtime_error("truncated deque snapshot");
+    }
+    size_ += step;
+    end_bucket_ = head_bucket_ + (head_cell_ + size_ - 1) / kBucketSize;
+    end_cell_ = (head_cell_ + size_ - 1) % kBucketSize;
+  }
+}
+
+template <typename T, typename Allocator>
+typename Deque<T, Allocator>::SnapshotHeader
+Deque<T, Allocator>::snapshot_header() const {
+  SnapshotChecksum checksum;
+  for_each_segment([&checksum](const T* ptr, size_t count) {
+    checksum.update(ptr, count * sizeof(T));
+  });
+  return SnapshotHeader{kSnapshotMagic, kSnapshotVersion, sizeof(T), size_,
+                        checksum.finish()};
+}
+
+template <typename T, typename Allocator>
+void Deque<T, Allocator>::check_snapshot_header(
+    const SnapshotHeader& header) const {
+  if (header.magic != kSnapshotMagic) {
+    throw std::runtime_error("not a deque snapshot");
+  }
+  if (header.version != kSnapshotVersion) {
+    throw std::runtime_error("unsupported deque snapshot version");
+  }
+  if (header.element_size != sizeof(T)) {
+    throw std::runtime_error("deque snapshot element size mismatch");
+  }
+  if (header.size > max_size()) {
+    throw std::runtime_error("deque snapshot size out of range");
+  }
+}
+
+template <typename T, typename Allocator>
+void Deque<T, Allocator>::transfer_all(int fd, iovec* iov, size_t count,
+                                       bool writing) {
+  while (count != 0) {
+    int chunk = static_cast<int>(std::min<size_t>(count, IOV_MAX));
+    ssize_t done = writing ? ::writev(fd, iov, chunk) : ::readv(fd, iov, chunk);
+    if (done < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::system_error(errno, std::generic_category(),
+                              writing ? "writev" : "readv");
+    }
+    if (done == 0 && !writing) {
+      throw std::runtime_error("truncated deque snapshot");
+    }
+    // Partial transfers are legal: skip what is done and retry the rest.
+    size_t left = static_cast<size_t>(done);
+    while (count != 0 && left >= iov->iov_len) {
+      left -= iov->iov_len;
+      ++iov;
+      --count;
+    }
+    if (count != 0) {
+      iov->iov_base = static_cast<char*>(iov->iov_base) + left;
+      iov->iov_len -= left;
+    }
+  }
+}
+
+template <typename T, typename Allocator>
+void Deque<T, Allocator>::write_to(int fd) const {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "binary snapshots require trivially copyable T");
+  SnapshotHeader header = snapshot_header();
+  std::vector<iovec> iov;
+  iov.reserve(size_ / kBucketSize + 3);
+  iov.push_back(iovec{&header, sizeof(header)});
+  for_each_segment([&iov](const T* ptr, size_t count) {
+    iov.push_back(iovec{const_cast<T*>(ptr), count * sizeof(T)});
+  });
+  transfer_all(fd, iov.data(), iov.size(), true);
+}
+
+template <typename T, typename Allocator>
+void Deque<T, Allocator>::write_to(std::ostream& out) const {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "binary snapshots require trivially copyable T");
+  SnapshotHeader header = snapshot_header();
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  for_each_segment([&out](const T* ptr, size_t count) {
+    out.write(reinterpret_cast<const char*>(ptr), count * sizeof(T));
+  });
+  if (!out) {
+    throw std::runtime_error("failed to write deque snapshot");
+  }
+}
+
+template <typename T, typename Allocator>
+void Deque<T, Allocator>::read_from(int fd) {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "binary snapshots require trivially copyable T");
+  SnapshotHeader header;
+  iovec header_iov{&header, sizeof(header)};
+  transfer_all(fd, &header_iov, 1, false);
+  check_snapshot_header(header);
+
+  struct stat status;
+  if (::fstat(fd, &status) != 0) {
+    throw std::system_error(errno, std::generic_category(), "fstat");
+  }
+  Deque restored(alloc_);
+  if (S_ISREG(status.st_mode)) {
+    // A file must hold every element the header announces, so storage for
+    // them is allocated at once and filled in one vectored read.
+    off_t offset = ::lseek(fd, 0, SEEK_CUR);
+    if (offset < 0) {
+      throw std::system_error(errno, std::generic_category(), "lseek");
+    }
+    size_t left = status.st_size > offset
+                      ? static_cast<size_t>(status.st_size - offset)
+                      : 0;
+    if (header.size > left / sizeof(T)) {
+      throw std::runtime_error("truncated deque snapshot");
+    }
+    restored.reset_storage(header.size);
+    std::vector<iovec> iov;
+    iov.reserve(restored.ptr_cnt_);
+    restored.for_each_segment([&iov](const T* ptr, size_t count) {
+      iov.push_back(iovec{const_cast<T*>(ptr), count * sizeof(T)});
+    });
+    transfer_all(fd, iov.data(), iov.size(), false);
+  } else {
+    restored.append_raw(header.size, [fd](iovec* iov, size_t count) {
+      transfer_all(fd, iov, count, false);
+      return true;
+    });
+  }
+  if (restored.snapshot_header().checksum != header.checksum) {
+    throw std::runtime_error("deque snapshot checksum mismatch");
+  }
+  my_swap(restored);
+}
+
+template <typename T, typename Allocator>
+void Deque<T, Allocator>::read_from(std::istream& in) {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "binary snapshots require trivially copyable T");
+  SnapshotHeader header;
+  if (!in.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+    throw std::runtime_error("truncated deque snapshot");
+  }
+  check_snapshot_header(header);
+
+  Deque restored(alloc_);
+  restored.append_raw(header.size, [&in](iovec* iov, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+      if (!in.read(static_cast<char*>(iov[i].iov_base), iov[i].iov_len)) {
+        return false;
+      }
+    }
+    return true;
+  });
+  if (restored.snapshot_header().checksum != header.checksum) {
+    throw std::runtime_error("deque snapshot checksum mismatch");
+  }
+  my_swap(restored);
+}
+
+template <typename T, typename Allocator>
+std::vector<size_t> Deque<T, Allocator>::chunk_bounds(size_t threads) const {
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  size_t buckets = (head_cell_ + size_ + kBucketSize - 1) / kBucketSize;
+  threads = std::max<size_t>(1, std::min(threads, buckets));
+  // Chunk edges fall on bucket edges, so no two threads share a bucket.
+  std::vector<size_t> bounds(threads + 1, size_);
+  for (size_t chunk = 0; chunk < threads; ++chunk) {
+    size_t bucket = chunk * buckets / threads;
+    bounds[chunk] =
+        bucket == 0 ? 0 : std::min(size_, bucket * kBucketSize - head_cell_);
+  }
+  return bounds;
+}
+
+template <typename T, typename Allocator>
+template <typename Task>
+void Deque<T, Allocator>::run_tasks(size_t count, Task task) {
+  std::vector<std::exception_ptr> errors(count);
+  auto guarded = [&task, &errors](size_t index) {
+    try {
+      task(index);
+    } catch (...) {
+      errors[index] = std::current_exception();
+    }
+  };
+  std::vector<std::thread> workers;
+  workers.reserve(count);
+  try {
+    for (size_t i = 1; i < count; ++i) {
+      workers.emplace_back(guarded, i);
+    }
+  } catch (...) {
+    for (std::thread& worker : workers) {
+      worker.join();
+    }
+    throw;
+  }
+  if (count != 0) {
+    guarded(0);
+  }
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+  for (std::exception_ptr& error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+}
+
+template <typename T, typename Allocator>
+template <typename Construct>
+void Deque<T, Allocator>::parallel_construct(const DequeParallel& policy,
+                                             Construct construct) {
+  std::vector<size_t> bounds = chunk_bounds(policy.threads);
+  std::vector<size_t> done(bounds.size() - 1, 0);
+  try {
+    run_tasks(done.size(), [this, &bounds, &done, &construct](size_t chunk) {
+      for (size_t i = bounds[chunk]; i < bounds[chunk + 1]; ++i) {
+        construct(&(*this)[i], i);
+        ++done[chunk];
+      }
+    });
+  } catch (...) {
+    // Chunks fail independently, so constructed elements are not a prefix.
+    for (size_t chunk = 0; chunk < done.size(); ++chunk) {
+      for (size_t i = 0; i < done[chunk]; ++i) {
+        alloc_traits::destroy(alloc_, &(*this)[bounds[chunk] + i]);
+      }
+    }
+    size_ = 0;
+    throw;
+  }
+}
+
+template <typename T, typename Allocator>
+template <typename Func>
+void Deque<T, Allocator>::parallel_for_each_bucket(const DequeParallel& policy,
+                                                   Func func) {
+  std::vector<size_t> bounds = chunk_bounds(policy.threads);
+  run_tasks(bounds.size() - 1, [this, &bounds, &func](size_t chunk) {
+    size_t index = bounds[chunk];
+    while (index < bounds[chunk + 1]) {
+      size_t cell = (head_cell_ + index) % kBucketSize;
+      size_t count = std::min(kBucketSize - cell, bounds[chunk + 1] - index);
+      T* first = &(*this)[index];
+      func(first, first + count);
+      index += count;
+    }
+  });
+}
+
+template <typename T, typename Allocator>
+template <typename Compare>
+void Deque<T, Allocator>::sort(const DequeParallel& policy, Compare comp) {
+  std::vector<size_t> bounds = chunk_bounds(policy.threads);
+  size_t runs = bounds.size() - 1;
+  run_tasks(runs, [this, &bounds, &comp](size_t chunk) {
+    std::sort(begin() + bounds[chunk], begin() + bounds[chunk + 1], comp);
+  });
+  for (size_t width = 1; width < runs; width *= 2) {
+    size_t merges = (runs + 2 * width - 1) / (2 * width);
+    run_tasks(merges, [this, &bounds, &comp, width, runs](size_t merge) {
+      size_t first = 2 * width * merge;
+      size_t middle = std::min(first + width, runs);
+      size_t last = std::min(first + 2 * width, runs);
+      std::inplace_merge(begin() + bounds[first], begin() + bounds[middle],
+                         begin() + bounds[last], comp);
+    });
+  }
+}
@@ -0,0 +1,339 @@
+// Benchmarks Deque against std::deque and std::vector.
+//
+//   g++ -std=c++20 -O2 -I. deque_benchmark.cpp -o deque_benchmark -pthread
+//   ./deque_benchmark [max_size]
+//
+// Sizes sweep powers of ten from 10 up to max_size (default 10^6, pass
+// 100000000 for the full sweep). Every line reports ns per operation, heap
+// allocations per operation and the peak RSS reached while the case ran.
+
+#include <sys/resource.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "deque.hpp"
+
+namespace {
+
+std::atomic<size_t> allocations{0};
+
+}  // namespace
+
+void* operator new(size_t bytes) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* ptr = std::malloc(bytes == 0 ? 1 : bytes)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+
+#pragma GCC diagnostic pop
+
+namespace {
+
+struct Pod64 {
+  int64_t words[8];
+};
+
+template <typename T>
+T MakeValue(size_t index);
+
+template <>
+int MakeValue<int>(size_t index) {
+  return static_cast<int>(index);
+}
+
+template <>
+Pod64 MakeValue<Pod64>(size_t index) {
+  Pod64 pod{};
+  pod.words[0] = static_cast<int64_t>(index);
+  return pod;
+}
+
+template <>
+std::string MakeValue<std::string>(size_t index) {
+  // Long enough to defeat the small string optimization.
+  return std::string(24, 'x') + std::to_string(index);
+}
+
+int64_t Touch(int value) { return value; }
+
+int64_t Touch(const Pod64& value) { return value.words[0]; }
+
+int64_t Touch(const std::string& value) { return value.size(); }
+
+template <typename T>
+void DoNotOptimize(const T& value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// Peak RSS is reset before each case where the kernel allows it, so the
+// figure belongs to the case rather than to the whole process.
+void ResetPeakRss() {
+  std::ofstream clear_refs("/proc/self/clear_refs");
+  clear_refs << "5";
+}
+
+long PeakRssKb() {
+  std::ifstream status("/proc/self/status");
+  std::string key;
+  while (status >> key) {
+    if (key == "VmHWM:") {
+      long value = 0;
+      status >> value;
+      return value;
+    }
+  }
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+template <typename Container>
+constexpr bool kHasFront = true;
+
+template <typename T>
+constexpr bool kHasFront<std::vector<T>> = false;
+
+template <typename Container>
+void PushFront(Container& container,
+               const typename Container::value_type& value) {
+  if constexpr (kHasFront<Container>) {
+    container.push_front(value);
+  }
+}
+
+template <typename Container>
+void PopFront(Container& container) {
+  if constexpr (kHasFront<Container>) {
+    container.pop_front();
+  }
+}
+
+template <typename Container>
+auto MiddleIterator(const Container& container) {
+  return container.begin() + static_cast<int>(container.size() / 2);
+}
+
+struct Report {
+  const char* container;
+  const char* type;
+  const char* name;
+};
+
+// Runs body() 'repeats' times, each doing 'ops' operations, and prints one
+// result line.
+template <typename Body>
+void Measure(const Report& report, size_t size, size_t ops, size_t repeats,
+             Body body) {
+  ResetPeakRss();
+  size_t allocations_before = allocations.load();
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < repeats; ++i) {
+    body();
+  }
+  auto finish = std::chrono::steady_clock::now();
+  // Read before PeakRssKb, which allocates.
+  size_t allocated = allocations.load() - allocations_before;
+  size_t total_ops = ops * repeats;
+  double ns = std::chrono::duration<double, std::nano>(finish - start).count();
+  std::printf("%-11s %-8s %-14s %10zu %10.2f ns/op %8.3f allocs/op %8ld KB\n",
+              report.container, report.type, report.name, size,
+              ns / total_ops, static_cast<double>(allocated) / total_ops,
+              PeakRssKb());
+}
+
+template <typename Container>
+Container Filled(size_t size) {
+  Container container;
+  for (size_t i = 0; i < size; ++i) {
+    container.push_back(MakeValue<typename Container::value_type>(i));
+  }
+  return container;
+}
+
+template <typename Container>
+void RunCases(const char* container_name, const char* type_name, size_t size) {
+  using T = typename Container::value_type;
+  // Enough repetitions for small sizes to run for a measurable time.
+  size_t repeats = std::max<size_t>(1, 1000000 / size);
+  std::vector<T> values;
+  values.reserve(size);
+  for (size_t i = 0; i < size; ++i) {
+    values.push_back(MakeValue<T>(i));
+  }
+  auto report = [&](const char* name) {
+    return Report{container_name, type_name, name};
+  };
+
+  Measure(report("push_back"), size, size, repeats, [&] {
+    Container container;
+    for (size_t i = 0; i < size; ++i) {
+      container.push_back(values[i]);
+    }
+    DoNotOptimize(container.size());
+  });
+
+  if constexpr (kHasFront<Container>) {
+    Measure(report("push_front"), size, size, repeats, [&] {
+      Container container;
+      for (size_t i = 0; i < size; ++i) {
+        PushFront(container, values[i]);
+      }
+      DoNotOptimize(container.size());
+    });
+
+    Measure(report("fifo"), size, 2 * size, repeats, [&] {
+      Container container;
+      for (size_t i = 0; i < size; ++i) {
+        container.push_back(values[i]);
+      }
+      for (size_t i = 0; i < size; ++i) {
+        PopFront(container);
+      }
+      DoNotOptimize(container.size());
+    });
+
+    Measure(report("mixed"), size, 2 * size, repeats, [&] {
+      Container container;
+      for (size_t i = 0; i < size; ++i) {
+        if (i % 2 == 0) {
+          container.push_back(values[i]);
+        } else {
+          PushFront(container, values[i]);
+        }
+      }
+      for (size_t i = 0; i < size; ++i) {
+        if (i % 3 == 0) {
+          container.pop_back();
+        } else {
+          PopFront(container);
+        }
+      }
+      DoNotOptimize(container.size());
+    });
+
+    // Growth: the slowest single push_front, which is the one paying for
+    // a map reallocation.
+    {
+      ResetPeakRss();
+      Container container;
+      double worst = 0;
+      for (size_t i = 0; i < size; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        PushFront(container, values[i]);
+        auto finish = std::chrono::steady_clock::now();
+        worst = std::max(
+            worst,
+            std::chrono::duration<double, std::nano>(finish - start).count());
+      }
+      std::printf("%-11s %-8s %-14s %10zu %10.2f ns max %28ld KB\n",
+                  container_name, type_name, "growth_front", size, worst,
+                  PeakRssKb());
+    }
+  }
+
+  Measure(report("lifo"), size, 2 * size, repeats, [&] {
+    Container container;
+    for (size_t i = 0; i < size; ++i) {
+      container.push_back(values[i]);
+    }
+    for (size_t i = 0; i < size; ++i) {
+      container.pop_back();
+    }
+    DoNotOptimize(container.size());
+  });
+
+  Container filled = Filled<Container>(size);
+  std::vector<size_t> indices(size);
+  std::mt19937_64 rng(size);
+  for (size_t& index : indices) {
+    index = rng() % size;
+  }
+
+  Measure(report("random_index"), size, size, repeats, [&] {
+    int64_t sum = 0;
+    for (size_t index : indices) {
+      sum += Touch(filled[index]);
+    }
+    DoNotOptimize(sum);
+  });
+
+  Measure(report("scan"), size, size, repeats, [&] {
+    int64_t sum = 0;
+    for (const T& value : filled) {
+      sum += Touch(value);
+    }
+    DoNotOptimize(sum);
+  });
+
+  Measure(report("copy"), size, size, repeats, [&] {
+    Container copy(filled);
+    DoNotOptimize(copy.size());
+  });
+
+  Measure(report("move"), size, 1, repeats, [&] {
+    Container moved(std::move(filled));
+    filled = std::move(moved);
+    DoNotOptimize(filled.size());
+  });
+
+  // Middle insert/erase are O(size) each, so they run at most a fixed
+  // number of times per case, once each. The container is filled before
+  // and freed after the timed loop, which would otherwise cost as much as
+  // the operations at small sizes.
+  size_t middle_ops = std::min<size_t>(size, 1000);
+  {
+    Container container = Filled<Container>(size);
+    Measure(report("middle_insert"), size, middle_ops, 1, [&] {
+      for (size_t i = 0; i < middle_ops; ++i) {
+        container.insert(MiddleIterator(container), values[i]);
+      }
+      DoNotOptimize(container.size());
+    });
+  }
+
+  {
+    Container container = Filled<Container>(size);
+    Measure(report("middle_erase"), size, middle_ops, 1, [&] {
+      for (size_t i = 0; i < middle_ops; ++i) {
+        container.erase(MiddleIterator(container));
+      }
+      DoNotOptimize(container.size());
+    });
+  }
+}
+
+template <typename T>
+void RunType(const char* type_name, size_t size) {
+  RunCases<Deque<T>>("Deque", type_name, size);
+  RunCases<std::deque<T>>("std::deque", type_name, size);
+  RunCases<std::vector<T>>("std::vector", type_name, size);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  size_t max_size = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+  for (size_t size = 10; size <= max_size; size *= 10) {
+    RunType<int>("int", size);
+    RunType<Pod64>("pod64", size);
+    RunType<std::string>("string", size);
+  }
+}
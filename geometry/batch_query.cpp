@@ -0,0 +1,134 @@
+#include "batch_query.hpp"
+
+#include <algorithm>
+
+#include "convex_hull.hpp"
+
+BatchQueryEngine::BatchQueryEngine(size_t threads) {
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  workers_.reserve(threads - 1);
+  for (size_t i = 1; i < threads; ++i) {
+    workers_.emplace_back([this] { WorkerLoop(); });
+  }
+}
+
+BatchQueryEngine::~BatchQueryEngine() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  start_.notify_all();
+  for (std::thread& worker : workers_) {
+    worker.join();
+  }
+}
+
+void BatchQueryEngine::ContainsPoints(const std::vector<const IShape*>& shapes,
+                                      const Point* points, size_t count,
+                                      uint8_t* out) {
+  size_t stride = shapes.size();
+  ParallelFor(count, kMinChunk, [&](size_t begin, size_t end) {
+    // Shape by shape within a chunk keeps each call site monomorphic.
+    for (size_t shape = 0; shape < stride; ++shape) {
+      const IShape& tested = *shapes[shape];
+      for (size_t query = begin; query < end; ++query) {
+        out[query * stride + shape] = tested.ContainsPoint(points[query]);
+      }
+    }
+  });
+}
+
+void BatchQueryEngine::CrossSegments(const std::vector<const IShape*>& shapes,
+                                     const Segment* segments, size_t count,
+                                     uint8_t* out) {
+  size_t stride = shapes.size();
+  ParallelFor(count, kMinChunk, [&](size_t begin, size_t end) {
+    for (size_t shape = 0; shape < stride; ++shape) {
+      const IShape& tested = *shapes[shape];
+      for (size_t query = begin; query < end; ++query) {
+        out[query * stride + shape] = tested.CrossSegment(segments[query]);
+      }
+    }
+  });
+}
+
+void BatchQueryEngine::ConvexHulls(const std::vector<std::vector<Point>>& sets,
+                                   std::vector<std::vector<size_t>>& hulls) {
+  hulls.resize(sets.size());
+  ParallelFor(sets.size(), kMinHullChunk, [&](size_t begin, size_t end) {
+    for (size_t set = begin; set < end; ++set) {
+      ConvexHull(sets[set].data(), sets[set].size(), hulls[set]);
+    }
+  });
+}
+
+void BatchQueryEngine::ParallelFor(size_t count, size_t min_chunk,
+                                   const Body& body) {
+  size_t chunk =
+      std::max(min_chunk, count / (ThreadCount() * kChunksPerThread));
+  if (workers_.empty() || count <= chunk) {
+    if (count != 0) {
+      body(0, count);
+    }
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    body_ = &body;
+    count_ = count;
+    chunk_ = chunk;
+    next_.store(0, std::memory_order_relaxed);
+    running_ = workers_.size();
+    ++generation_;
+  }
+  start_.notify_all();
+  RunChunks();
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_.wait(lock, [this] { return running_ == 0; });
+  body_ = nullptr;
+  if (error_) {
+    std::exception_ptr error = error_;
+    error_ = nullptr;
+    std::rethrow_exception(error);
+  }
+}
+
+void BatchQueryEngine::RunChunks() {
+  try {
+    for (;;) {
+      size_t begin = next_.fetch_add(chunk_, std::memory_order_relaxed);
+      if (begin >= count_) {
+        return;
+      }
+      (*body_)(begin, std::min(count_, begin + chunk_));
+    }
+  } catch (...) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!error_) {
+      error_ = std::current_exception();
+    }
+    // Stops the other threads at their next chunk.
+    next_.store(count_, std::memory_order_relaxed);
+  }
+}
+
+void BatchQueryEngine::WorkerLoop() {
+  size_t seen = 0;
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      start_.wait(lock, [&] { return stopping_ || generation_ != seen; });
+      if (stopping_) {
+        return;
+      }
+      seen = generation_;
+    }
+    RunChunks();
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (--running_ == 0) {
+      done_.notify_one();
+    }
+  }
+}
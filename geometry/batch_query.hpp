@@ -0,0 +1,76 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "geometry.hpp"
+
+// Evaluates predicates of caller-owned shapes over large query batches on
+// a fixed pool of threads. A batch is cut into chunks that threads claim
+// from a shared cursor as they finish, so uneven predicate costs balance
+// out. Results go to a buffer the caller provides, with count *
+// shapes.size() bytes: out[q * shapes.size() + s] is 1 if shape s passes
+// for query q. Nothing is allocated per query and shapes are not cloned.
+// One batch runs at a time: an engine must not be shared between threads.
+class BatchQueryEngine {
+ public:
+  // The calling thread counts as one of 'threads'; zero means
+  // hardware_concurrency().
+  explicit BatchQueryEngine(size_t threads = 0);
+
+  BatchQueryEngine(const BatchQueryEngine&) = delete;
+
+  BatchQueryEngine& operator=(const BatchQueryEngine&) = delete;
+
+  ~BatchQueryEngine();
+
+  size_t ThreadCount() const { return workers_.size() + 1; }
+
+  void ContainsPoints(const std::vector<const IShape*>& shapes,
+                      const Point* points, size_t count, uint8_t* out);
+
+  void CrossSegments(const std::vector<const IShape*>& shapes,
+                     const Segment* segments, size_t count, uint8_t* out);
+
+  // hulls[i] becomes ConvexHull(sets[i]). Sets are handed out a chunk at a
+  // time, for batches of many small sets.
+  void ConvexHulls(const std::vector<std::vector<Point>>& sets,
+                   std::vector<std::vector<size_t>>& hulls);
+
+ private:
+  using Body = std::function<void(size_t, size_t)>;
+
+  // Smallest chunk handed out, in queries and in hull sets, and chunks
+  // aimed at per thread.
+  static const size_t kMinChunk = 1024;
+  static const size_t kMinHullChunk = 16;
+  static const size_t kChunksPerThread = 16;
+
+  // Calls body(begin, end) over chunks of at least 'min_chunk' covering
+  // [0, count) on every thread, and returns once all are done. The first
+  // exception thrown by a chunk is rethrown here.
+  void ParallelFor(size_t count, size_t min_chunk, const Body& body);
+
+  void RunChunks();
+
+  void WorkerLoop();
+
+  std::vector<std::thread> workers_;
+  std::mutex mutex_;
+  std::condition_variable start_;
+  std::condition_variable done_;
+  const Body* body_ = nullptr;
+  size_t count_ = 0;
+  size_t chunk_ = 0;
+  std::atomic<size_t> next_{0};
+  size_t generation_ = 0;
+  size_t running_ = 0;
+  bool stopping_ = false;
+  std::exception_ptr error_;
+};
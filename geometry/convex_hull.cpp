@@ -0,0 +1,223 @@
+#include "convex_hull.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <thread>
+#include <tuple>
+
+namespace {
+
+// Sorting and scanning copies of the coordinates keeps the passes over
+// contiguous memory.
+struct Slot {
+  int64_t xcord;
+  int64_t ycord;
+  size_t id;
+
+  Vector operator-(const Slot& other) const {
+    return Vector(xcord - other.xcord, ycord - other.ycord);
+  }
+
+  bool operator<(const Slot& other) const {
+    return std::tie(xcord, ycord, id) <
+           std::tie(other.xcord, other.ycord, other.id);
+  }
+
+  bool SamePlace(const Slot& other) const {
+    return xcord == other.xcord && ycord == other.ycord;
+  }
+};
+
+// Below this many points per thread the sort stays on one thread.
+const size_t kMinParallelRun = 1 << 16;
+
+thread_local std::vector<Slot> slots;
+
+void FillSlots(const Point* points, size_t count) {
+  slots.resize(count);
+  for (size_t id = 0; id < count; ++id) {
+    slots[id] = Slot{points[id].GetX(), points[id].GetY(), id};
+  }
+}
+
+// Runs task(0) .. task(count - 1), one per thread, on the calling thread
+// and count - 1 new ones.
+template <typename Task>
+void RunTasks(size_t count, Task task) {
+  std::vector<std::thread> workers;
+  workers.reserve(count);
+  try {
+    for (size_t i = 1; i < count; ++i) {
+      workers.emplace_back(task, i);
+    }
+  } catch (...) {
+    for (std::thread& worker : workers) {
+      worker.join();
+    }
+    throw;
+  }
+  task(0);
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+}
+
+// Sorts runs on separate threads, then merges them pairwise.
+void ParallelSort(std::vector<Slot>& items, size_t threads) {
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  size_t runs = std::max<size_t>(
+      1, std::min(threads, items.size() / kMinParallelRun));
+  if (runs == 1) {
+    std::sort(items.begin(), items.end());
+    return;
+  }
+  std::vector<size_t> bounds(runs + 1);
+  for (size_t run = 0; run <= runs; ++run) {
+    bounds[run] = run * items.size() / runs;
+  }
+  auto at = [&items, &bounds](size_t run) {
+    return items.begin() + bounds[run];
+  };
+  RunTasks(runs, [&at](size_t run) { std::sort(at(run), at(run + 1)); });
+  for (size_t width = 1; width < runs; width *= 2) {
+    size_t merges = (runs + 2 * width - 1) / (2 * width);
+    RunTasks(merges, [&at, width, runs](size_t merge) {
+      size_t first = 2 * width * merge;
+      size_t middle = std::min(first + width, runs);
+      size_t last = std::min(first + 2 * width, runs);
+      std::inplace_merge(at(first), at(middle), at(last));
+    });
+  }
+}
+
+// True if 'point' is strictly to the right of the line from 'from' to 'to'.
+bool RightOf(const Slot& from, const Slot& to, const Slot& point) {
+  return CrossSign(to - from, point - from) < 0;
+}
+
+// Appends the hull vertices strictly between 'from' and 'to', given the
+// points in [begin, end) that lie right of that edge.
+void FindHull(const Slot& from, const Slot& to, Slot* begin, Slot* end,
+              std::vector<size_t>& out) {
+  if (begin == end) {
+    return;
+  }
+  // The farthest point; among equally far ones the one nearest 'to',
+  // so the others are outside the edge from 'from' to it.
+  Vector edge = to - from;
+  Slot* farthest = begin;
+  __int128 best_cross = WideCross(edge, *begin - from);
+  __int128 best_dot = WideDot(edge, *begin - from);
+  for (Slot* slot = begin + 1; slot != end; ++slot) {
+    __int128 cross = WideCross(edge, *slot - from);
+    __int128 dot = WideDot(edge, *slot - from);
+    if (std::tie(cross, best_dot, slot->id) <
+        std::tie(best_cross, dot, farthest->id)) {
+      farthest = slot;
+      best_cross = cross;
+      best_dot = dot;
+    }
+  }
+  Slot apex = *farthest;
+  Slot* middle = std::partition(begin, end, [&](const Slot& slot) {
+    return RightOf(from, apex, slot);
+  });
+  Slot* last = std::partition(middle, end, [&](const Slot& slot) {
+    return RightOf(apex, to, slot);
+  });
+  FindHull(from, apex, begin, middle, out);
+  out.push_back(apex.id);
+  FindHull(apex, to, middle, last, out);
+}
+
+}  // namespace
+
+std::vector<size_t> ConvexHull(const std::vector<Point>& points,
+                               size_t threads) {
+  std::vector<size_t> out;
+  ConvexHull(points.data(), points.size(), out, threads);
+  return out;
+}
+
+std::vector<size_t> QuickHull(const std::vector<Point>& points) {
+  std::vector<size_t> out;
+  QuickHull(points.data(), points.size(), out);
+  return out;
+}
+
+void ConvexHull(const Point* points, size_t count, std::vector<size_t>& out,
+                size_t threads) {
+  out.clear();
+  FillSlots(points, count);
+  ParallelSort(slots, threads);
+  // Equal points are adjacent, the smallest index first.
+  slots.erase(std::unique(slots.begin(), slots.end(),
+                          [](const Slot& left, const Slot& right) {
+                            return left.SamePlace(right);
+                          }),
+              slots.end());
+  if (slots.size() <= 2) {
+    for (const Slot& slot : slots) {
+      out.push_back(slot.id);
+    }
+    return;
+  }
+  // Lower chain left to right, then upper chain back; 'chain' holds
+  // positions in 'slots' and ends with the first point again.
+  thread_local std::vector<size_t> chain;
+  chain.assign(2 * slots.size(), 0);
+  size_t size = 0;
+  auto push = [&](size_t pos, size_t floor) {
+    while (size >= floor &&
+           CrossSign(slots[chain[size - 1]] - slots[chain[size - 2]],
+                     slots[pos] - slots[chain[size - 2]]) <= 0) {
+      --size;
+    }
+    chain[size++] = pos;
+  };
+  for (size_t pos = 0; pos < slots.size(); ++pos) {
+    push(pos, 2);
+  }
+  size_t lower = size + 1;
+  for (size_t pos = slots.size() - 1; pos-- > 0;) {
+    push(pos, lower);
+  }
+  for (size_t i = 0; i + 1 < size; ++i) {
+    out.push_back(slots[chain[i]].id);
+  }
+}
+
+void QuickHull(const Point* points, size_t count, std::vector<size_t>& out) {
+  out.clear();
+  if (count == 0) {
+    return;
+  }
+  FillSlots(points, count);
+  // The extremes in x then y, the smallest index among equal points.
+  Slot first = slots[0];
+  Slot last = slots[0];
+  for (const Slot& slot : slots) {
+    first = std::min(first, slot);
+    if (std::tie(slot.xcord, slot.ycord, last.id) >
+        std::tie(last.xcord, last.ycord, slot.id)) {
+      last = slot;
+    }
+  }
+  out.push_back(first.id);
+  if (first.SamePlace(last)) {
+    return;
+  }
+  Slot* begin = slots.data();
+  Slot* end = begin + slots.size();
+  Slot* middle = std::partition(begin, end, [&](const Slot& slot) {
+    return RightOf(first, last, slot);
+  });
+  Slot* upper_end = std::partition(middle, end, [&](const Slot& slot) {
+    return RightOf(last, first, slot);
+  });
+  FindHull(first, last, begin, middle, out);
+  out.push_back(last.id);
+  FindHull(last, first, middle, upper_end, out);
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+#include "geometry.hpp"
+
+// Convex hulls of point sets, as indices into the input. A hull runs
+// counter-clockwise from its lowest point among the leftmost ones.
+// Points inside an edge are left out, and of several equal points only
+// the one with the smallest index is used. Fewer than three distinct
+// points give the distinct ones in that order. Orientation is CrossSign,
+// exact for coordinates below 2^62. Both routines return the same hull.
+
+// Andrew's monotone chain. The points are sorted by x then y on 'threads'
+// threads, zero meaning hardware_concurrency(); small inputs use one.
+std::vector<size_t> ConvexHull(const std::vector<Point>& points,
+                               size_t threads = 1);
+
+// QuickHull: recursively splits off the points outside the farthest point
+// from each edge, which drops the interior of large clouds early.
+std::vector<size_t> QuickHull(const std::vector<Point>& points);
+
+// The same over 'count' points, replacing the contents of 'out' so its
+// storage is reused across calls.
+void ConvexHull(const Point* points, size_t count, std::vector<size_t>& out,
+                size_t threads = 1);
+
+void QuickHull(const Point* points, size_t count, std::vector<size_t>& out);
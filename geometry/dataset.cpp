@@ -0,0 +1,236 @@
+#include "dataset.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+namespace {
+
+const char kMagic[8] = {'G', 'E', 'O', 'M', 'S', 'E', 'T', '\0'};
+const uint32_t kByteOrderMark = 0x01020304;
+const uint32_t kVersion = 1;
+const uint64_t kAlignment = 64;
+
+uint64_t AlignUp(uint64_t offset) {
+  return (offset + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+// The five values of a record.
+struct Record {
+  uint8_t kind;
+  int64_t coords[4];
+};
+
+Record Encode(const IShape& shape) {
+  Record record{static_cast<uint8_t>(shape.GetKind()), {0, 0, 0, 0}};
+  auto put = [&record](size_t slot, const Point& point) {
+    record.coords[slot] = point.GetX();
+    record.coords[slot + 1] = point.GetY();
+  };
+  switch (shape.GetKind()) {
+    case ShapeKind::kPoint:
+      put(0, static_cast<const Point&>(shape));
+      break;
+    case ShapeKind::kSegment:
+      put(0, static_cast<const Segment&>(shape).GetA());
+      put(2, static_cast<const Segment&>(shape).GetB());
+      break;
+    case ShapeKind::kLine:
+      put(0, static_cast<const Line&>(shape).GetFirst());
+      put(2, static_cast<const Line&>(shape).GetSecond());
+      break;
+    case ShapeKind::kRay: {
+      const Ray& ray = static_cast<const Ray&>(shape);
+      Point second = ray.GetA();
+      second += ray.GetVector();
+      put(0, ray.GetA());
+      put(2, second);
+      break;
+    }
+    case ShapeKind::kCircle: {
+      const Circle& circle = static_cast<const Circle&>(shape);
+      put(0, circle.GetCentre());
+      record.coords[2] = static_cast<int64_t>(circle.GetRadius());
+      break;
+    }
+    case ShapeKind::kPolygon:
+      throw std::invalid_argument("WriteDataset: polygons are not supported");
+  }
+  return record;
+}
+
+}  // namespace
+
+void WriteDataset(const std::string& path,
+                  const std::vector<const IShape*>& shapes) {
+  std::vector<Record> records;
+  records.reserve(shapes.size());
+  for (const IShape* shape : shapes) {
+    records.push_back(Encode(*shape));
+  }
+
+  DatasetHeader header;
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.byte_order = kByteOrderMark;
+  header.version = kVersion;
+  header.count = records.size();
+  header.kinds_offset = AlignUp(sizeof(DatasetHeader));
+  uint64_t* coord_offsets[4] = {&header.x0_offset, &header.y0_offset,
+                                &header.x1_offset, &header.y1_offset};
+  uint64_t end = header.kinds_offset + header.count;
+  for (uint64_t* offset : coord_offsets) {
+    *offset = AlignUp(end);
+    end = *offset + header.count * sizeof(int64_t);
+  }
+
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  uint64_t written = 0;
+  auto pad_to = [&](uint64_t offset) {
+    static const char kZeros[kAlignment] = {};
+    file.write(kZeros, static_cast<std::streamsize>(offset - written));
+    written = offset;
+  };
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  written = sizeof(header);
+  pad_to(header.kinds_offset);
+  std::vector<uint8_t> kinds(records.size());
+  std::transform(records.begin(), records.end(), kinds.begin(),
+                 [](const Record& record) { return record.kind; });
+  file.write(reinterpret_cast<const char*>(kinds.data()),
+             static_cast<std::streamsize>(kinds.size()));
+  written += kinds.size();
+  std::vector<int64_t> column(records.size());
+  for (size_t slot = 0; slot < 4; ++slot) {
+    pad_to(*coord_offsets[slot]);
+    for (size_t i = 0; i < records.size(); ++i) {
+      column[i] = records[i].coords[slot];
+    }
+    file.write(reinterpret_cast<const char*>(column.data()),
+               static_cast<std::streamsize>(column.size() * sizeof(int64_t)));
+    written += column.size() * sizeof(int64_t);
+  }
+  file.close();
+  if (!file) {
+    throw std::runtime_error("WriteDataset: cannot write " + path);
+  }
+}
+
+Dataset::Dataset(const std::string& path) {
+  int descriptor = open(path.c_str(), O_RDONLY);
+  if (descriptor < 0) {
+    throw std::system_error(errno, std::generic_category(),
+                            "Dataset: cannot open " + path);
+  }
+  struct stat status;
+  if (fstat(descriptor, &status) != 0) {
+    int error = errno;
+    close(descriptor);
+    throw std::system_error(error, std::generic_category(),
+                            "Dataset: cannot stat " + path);
+  }
+  length_ = static_cast<size_t>(status.st_size);
+  if (length_ < sizeof(DatasetHeader)) {
+    close(descriptor);
+    throw std::runtime_error("Dataset: " + path + " is too short");
+  }
+  mapping_ = mmap(nullptr, length_, PROT_READ, MAP_PRIVATE, descriptor, 0);
+  int error = errno;
+  close(descriptor);
+  if (mapping_ == MAP_FAILED) {
+    mapping_ = nullptr;
+    throw std::system_error(error, std::generic_category(),
+                            "Dataset: cannot map " + path);
+  }
+
+  const auto* base = static_cast<const unsigned char*>(mapping_);
+  DatasetHeader header;
+  std::memcpy(&header, base, sizeof(header));
+  uint64_t offsets[4] = {header.x0_offset, header.y0_offset, header.x1_offset,
+                         header.y1_offset};
+  bool valid = std::memcmp(header.magic, kMagic, sizeof(kMagic)) == 0 &&
+               header.byte_order == kByteOrderMark &&
+               header.version == kVersion &&
+               header.count <= length_ &&
+               header.kinds_offset <= length_ - header.count;
+  for (uint64_t offset : offsets) {
+    valid = valid && offset % alignof(int64_t) == 0 && offset <= length_ &&
+            header.count <= (length_ - offset) / sizeof(int64_t);
+  }
+  if (!valid) {
+    Unmap();
+    throw std::runtime_error("Dataset: " + path +
+                             " is not a version 1 dataset in this byte order");
+  }
+  count_ = header.count;
+  kinds_ = base + header.kinds_offset;
+  x0_ = reinterpret_cast<const int64_t*>(base + offsets[0]);
+  y0_ = reinterpret_cast<const int64_t*>(base + offsets[1]);
+  x1_ = reinterpret_cast<const int64_t*>(base + offsets[2]);
+  y1_ = reinterpret_cast<const int64_t*>(base + offsets[3]);
+}
+
+Dataset::Dataset(Dataset&& other) noexcept { *this = std::move(other); }
+
+Dataset& Dataset::operator=(Dataset&& other) noexcept {
+  if (this != &other) {
+    Unmap();
+    mapping_ = std::exchange(other.mapping_, nullptr);
+    length_ = std::exchange(other.length_, 0);
+    count_ = std::exchange(other.count_, 0);
+    kinds_ = std::exchange(other.kinds_, nullptr);
+    x0_ = std::exchange(other.x0_, nullptr);
+    y0_ = std::exchange(other.y0_, nullptr);
+    x1_ = std::exchange(other.x1_, nullptr);
+    y1_ = std::exchange(other.y1_, nullptr);
+  }
+  return *this;
+}
+
+Dataset::~Dataset() { Unmap(); }
+
+void Dataset::Unmap() {
+  if (mapping_ != nullptr) {
+    munmap(mapping_, length_);
+    mapping_ = nullptr;
+  }
+}
+
+ShapeKind Dataset::Kind(size_t index) const {
+  if (index >= count_) {
+    throw std::out_of_range("Dataset: no such record");
+  }
+  if (kinds_[index] > static_cast<uint8_t>(ShapeKind::kCircle)) {
+    throw std::runtime_error("Dataset: corrupt shape kind");
+  }
+  return static_cast<ShapeKind>(kinds_[index]);
+}
+
+ShapeVariant Dataset::Get(size_t index) const {
+  ShapeKind kind = Kind(index);
+  Point first(x0_[index], y0_[index]);
+  Point second(x1_[index], y1_[index]);
+  switch (kind) {
+    case ShapeKind::kPoint:
+      return first;
+    case ShapeKind::kSegment:
+      return Segment(first, second);
+    case ShapeKind::kLine:
+      return Line(first, second);
+    case ShapeKind::kRay:
+      return Ray(first, second);
+    case ShapeKind::kCircle:
+      return Circle(first, static_cast<size_t>(x1_[index]));
+    case ShapeKind::kPolygon:
+      break;
+  }
+  throw std::runtime_error("Dataset: corrupt shape kind");
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "geometry.hpp"
+#include "shape_set.hpp"
+
+// Binary dataset of Points, Segments, Lines, Rays and Circles. After a
+// 64-byte header come five columns, each starting on a 64-byte boundary:
+// a uint8_t ShapeKind per record, then int64_t x0, y0, x1 and y1. A Point
+// uses (x0, y0); a Segment, Line or Ray its two defining points; a Circle
+// its centre, with the radius bits in x1. Unused slots are zero. Values are
+// in the writer's byte order, which the header records.
+struct DatasetHeader {
+  char magic[8];
+  uint32_t byte_order;
+  uint32_t version;
+  uint64_t count;
+  uint64_t kinds_offset;
+  uint64_t x0_offset;
+  uint64_t y0_offset;
+  uint64_t x1_offset;
+  uint64_t y1_offset;
+};
+
+static_assert(sizeof(DatasetHeader) == 64);
+
+// Throws std::invalid_argument for a shape the format has no kind for,
+// before anything is written, and std::runtime_error if writing fails.
+void WriteDataset(const std::string& path,
+                  const std::vector<const IShape*>& shapes);
+
+// Read-only memory mapping of a dataset file. Opening checks the header
+// and the file size but touches no column, so it does not depend on the
+// dataset size; pages are read in as the columns are used. The column
+// pointers can be handed to the batch predicates directly, for example
+// X0() and Y0() of a points-only dataset to Circle::ContainsPoints.
+class Dataset {
+ public:
+  // Throws std::system_error if the file cannot be mapped and
+  // std::runtime_error if it is not a dataset of a known version.
+  explicit Dataset(const std::string& path);
+
+  Dataset(Dataset&& other) noexcept;
+
+  Dataset& operator=(Dataset&& other) noexcept;
+
+  Dataset(const Dataset&) = delete;
+
+  Dataset& operator=(const Dataset&) = delete;
+
+  ~Dataset();
+
+  size_t Size() const { return count_; }
+
+  ShapeKind Kind(size_t index) const;
+
+  // Builds record 'index' by value.
+  ShapeVariant Get(size_t index) const;
+
+  const uint8_t* Kinds() const { return kinds_; }
+
+  const int64_t* X0() const { return x0_; }
+
+  const int64_t* Y0() const { return y0_; }
+
+  const int64_t* X1() const { return x1_; }
+
+  const int64_t* Y1() const { return y1_; }
+
+ private:
+  void Unmap();
+
+  void* mapping_ = nullptr;
+  size_t length_ = 0;
+  size_t count_ = 0;
+  const uint8_t* kinds_ = nullptr;
+  const int64_t* x0_ = nullptr;
+  const int64_t* y0_ = nullptr;
+  const int64_t* x1_ = nullptr;
+  const int64_t* y1_ = nullptr;
+};
@@ -0,0 +1,372 @@
+#include "dynamic_index.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+namespace {
+
+// Open sides stay open; a finite side saturates.
+int64_t ShiftCoord(int64_t coord, int64_t shift) {
+  if (coord == BoundingBox::kMin || coord == BoundingBox::kMax) {
+    return coord;
+  }
+  return SaturatingAdd(coord, shift);
+}
+
+BoundingBox Shift(const BoundingBox& box, const Vector& shift) {
+  return BoundingBox{ShiftCoord(box.min_x, shift.GetX()),
+                     ShiftCoord(box.min_y, shift.GetY()),
+                     ShiftCoord(box.max_x, shift.GetX()),
+                     ShiftCoord(box.max_y, shift.GetY())};
+}
+
+bool Within(const BoundingBox& inner, const BoundingBox& outer) {
+  return outer.min_x <= inner.min_x && outer.min_y <= inner.min_y &&
+         inner.max_x <= outer.max_x && inner.max_y <= outer.max_y;
+}
+
+std::pair<size_t, size_t> MakePair(size_t first, size_t second) {
+  return std::minmax(first, second);
+}
+
+void InsertSorted(std::vector<size_t>& ids, size_t id) {
+  ids.insert(std::lower_bound(ids.begin(), ids.end(), id), id);
+}
+
+void EraseSorted(std::vector<size_t>& ids, size_t id) {
+  ids.erase(std::lower_bound(ids.begin(), ids.end(), id));
+}
+
+}  // namespace
+
+DynamicShapeGrid::DynamicShapeGrid(int64_t cell_size, int64_t margin)
+    : cell_size_(cell_size), margin_(margin), groups_(1) {
+  if (cell_size_ <= 0) {
+    throw std::invalid_argument(
+        "DynamicShapeGrid: cell size must be positive");
+  }
+  if (margin_ < 0) {
+    throw std::invalid_argument(
+        "DynamicShapeGrid: margin must not be negative");
+  }
+}
+
+int64_t DynamicShapeGrid::CellOf(int64_t coord) const {
+  int64_t cell = coord / cell_size_;
+  return (coord % cell_size_ < 0) ? cell - 1 : cell;
+}
+
+size_t DynamicShapeGrid::AddGroup(const Vector& offset) {
+  groups_.emplace_back();
+  groups_.back().offset = offset;
+  return groups_.size() - 1;
+}
+
+Vector DynamicShapeGrid::GetOffset(size_t group) const {
+  if (group >= groups_.size()) {
+    throw std::out_of_range("DynamicShapeGrid: no such group");
+  }
+  return groups_[group].offset;
+}
+
+void DynamicShapeGrid::MoveGroup(size_t group, const Vector& vector) {
+  if (group >= groups_.size()) {
+    throw std::out_of_range("DynamicShapeGrid: no such group");
+  }
+  groups_[group].offset += vector;
+  if (!groups_[group].moved) {
+    groups_[group].moved = true;
+    moved_groups_.push_back(group);
+  }
+}
+
+const DynamicShapeGrid::Entry& DynamicShapeGrid::EntryAt(size_t id) const {
+  if (id >= entries_.size() || entries_[id].shape == nullptr) {
+    throw std::out_of_range("DynamicShapeGrid: no such id");
+  }
+  return entries_[id];
+}
+
+IShape* DynamicShapeGrid::GetShape(size_t id) const {
+  return EntryAt(id).shape;
+}
+
+size_t DynamicShapeGrid::GetGroup(size_t id) const {
+  return EntryAt(id).group;
+}
+
+void DynamicShapeGrid::Place(size_t id) {
+  Entry& entry = entries_[id];
+  entry.fat_box = BoundingBox{SaturatingSub(entry.box.min_x, margin_),
+                              SaturatingSub(entry.box.min_y, margin_),
+                              SaturatingAdd(entry.box.max_x, margin_),
+                              SaturatingAdd(entry.box.max_y, margin_)};
+  entry.large = !entry.fat_box.IsFinite();
+  if (!entry.large) {
+    entry.min_cell = {CellOf(entry.fat_box.min_x), CellOf(entry.fat_box.min_y)};
+    entry.max_cell = {CellOf(entry.fat_box.max_x), CellOf(entry.fat_box.max_y)};
+    uint64_t columns = static_cast<uint64_t>(entry.max_cell.column) -
+                       static_cast<uint64_t>(entry.min_cell.column) + 1;
+    uint64_t rows = static_cast<uint64_t>(entry.max_cell.row) -
+                    static_cast<uint64_t>(entry.min_cell.row) + 1;
+    entry.large = columns > kMaxCellsPerShape || rows > kMaxCellsPerShape ||
+                  columns * rows > kMaxCellsPerShape;
+  }
+  Group& group = groups_[entry.group];
+  if (entry.large) {
+    group.large.push_back(id);
+    return;
+  }
+  for (int64_t row = entry.min_cell.row; row <= entry.max_cell.row; ++row) {
+    for (int64_t column = entry.min_cell.column;
+         column <= entry.max_cell.column; ++column) {
+      group.cells[Cell{column, row}].push_back(id);
+    }
+  }
+}
+
+void DynamicShapeGrid::Unplace(size_t id) {
+  Entry& entry = entries_[id];
+  Group& group = groups_[entry.group];
+  auto erase_id = [id](std::vector<size_t>& ids) {
+    auto found = std::find(ids.begin(), ids.end(), id);
+    *found = ids.back();
+    ids.pop_back();
+  };
+  if (entry.large) {
+    erase_id(group.large);
+    return;
+  }
+  for (int64_t row = entry.min_cell.row; row <= entry.max_cell.row; ++row) {
+    for (int64_t column = entry.min_cell.column;
+         column <= entry.max_cell.column; ++column) {
+      auto cell = group.cells.find(Cell{column, row});
+      erase_id(cell->second);
+      if (cell->second.empty()) {
+        group.cells.erase(cell);
+      }
+    }
+  }
+}
+
+size_t DynamicShapeGrid::Insert(IShape* shape, size_t group) {
+  if (group >= groups_.size()) {
+    throw std::out_of_range("DynamicShapeGrid: no such group");
+  }
+  size_t id = entries_.size();
+  if (free_ids_.empty()) {
+    entries_.emplace_back();
+  } else {
+    id = free_ids_.back();
+    free_ids_.pop_back();
+  }
+  Entry& entry = entries_[id];
+  entry.shape = shape;
+  entry.group = group;
+  entry.slot = groups_[group].members.size();
+  entry.box = shape->GetBoundingBox();
+  entry.dirty = true;
+  groups_[group].members.push_back(id);
+  Place(id);
+  dirty_.push_back(id);
+  ++size_;
+  return id;
+}
+
+bool DynamicShapeGrid::Remove(size_t id) {
+  if (id >= entries_.size() || entries_[id].shape == nullptr) {
+    return false;
+  }
+  Unplace(id);
+  Entry& entry = entries_[id];
+  std::vector<size_t>& members = groups_[entry.group].members;
+  members[entry.slot] = members.back();
+  entries_[members.back()].slot = entry.slot;
+  members.pop_back();
+  for (size_t partner : entry.partners) {
+    EraseSorted(entries_[partner].partners, id);
+    removed_pairs_.push_back(MakePair(id, partner));
+  }
+  entry = Entry();
+  free_ids_.push_back(id);
+  --size_;
+  return true;
+}
+
+void DynamicShapeGrid::Move(size_t id, const Vector& vector) {
+  EntryAt(id);
+  Entry& entry = entries_[id];
+  entry.shape->Move(vector);
+  entry.box = entry.shape->GetBoundingBox();
+  if (!Within(entry.box, entry.fat_box)) {
+    Unplace(id);
+    Place(id);
+  }
+  if (!entry.dirty) {
+    entry.dirty = true;
+    dirty_.push_back(id);
+  }
+}
+
+void DynamicShapeGrid::Collect(const Group& group, const BoundingBox& box,
+                               std::vector<size_t>& ids) const {
+  ids.insert(ids.end(), group.large.begin(), group.large.end());
+  Cell min_cell{CellOf(box.min_x), CellOf(box.min_y)};
+  Cell max_cell{CellOf(box.max_x), CellOf(box.max_y)};
+  uint64_t columns = static_cast<uint64_t>(max_cell.column) -
+                     static_cast<uint64_t>(min_cell.column) + 1;
+  uint64_t rows = static_cast<uint64_t>(max_cell.row) -
+                  static_cast<uint64_t>(min_cell.row) + 1;
+  size_t occupied = group.cells.size();
+  if (columns > occupied || rows > occupied || columns * rows > occupied) {
+    // Walking the range would visit more cells than are occupied.
+    for (const auto& [cell, cell_ids] : group.cells) {
+      if (cell.column >= min_cell.column && cell.column <= max_cell.column &&
+          cell.row >= min_cell.row && cell.row <= max_cell.row) {
+        ids.insert(ids.end(), cell_ids.begin(), cell_ids.end());
+      }
+    }
+    return;
+  }
+  for (int64_t row = min_cell.row; row <= max_cell.row; ++row) {
+    for (int64_t column = min_cell.column; column <= max_cell.column;
+         ++column) {
+      auto found = group.cells.find(Cell{column, row});
+      if (found != group.cells.end()) {
+        ids.insert(ids.end(), found->second.begin(), found->second.end());
+      }
+    }
+  }
+}
+
+std::vector<size_t> DynamicShapeGrid::QueryContains(const Point& point) const {
+  std::vector<size_t> result;
+  for (const Group& group : groups_) {
+    Point local(point.GetX() - group.offset.GetX(),
+                point.GetY() - group.offset.GetY());
+    std::vector<size_t> ids = group.large;
+    auto found =
+        group.cells.find(Cell{CellOf(local.GetX()), CellOf(local.GetY())});
+    if (found != group.cells.end()) {
+      ids.insert(ids.end(), found->second.begin(), found->second.end());
+    }
+    for (size_t id : ids) {
+      if (entries_[id].shape->ContainsPoint(local)) {
+        result.push_back(id);
+      }
+    }
+  }
+  return result;
+}
+
+std::vector<size_t> DynamicShapeGrid::QueryCrossing(
+    const Segment& segment) const {
+  std::vector<size_t> result;
+  std::vector<size_t> ids;
+  for (const Group& group : groups_) {
+    Segment local(Point(segment.GetA().GetX() - group.offset.GetX(),
+                        segment.GetA().GetY() - group.offset.GetY()),
+                  Point(segment.GetB().GetX() - group.offset.GetX(),
+                        segment.GetB().GetY() - group.offset.GetY()));
+    ids.clear();
+    Collect(group, local.GetBoundingBox(), ids);
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    for (size_t id : ids) {
+      if (entries_[id].shape->CrossSegment(local)) {
+        result.push_back(id);
+      }
+    }
+  }
+  return result;
+}
+
+void DynamicShapeGrid::CheckPairs(
+    size_t id, bool own_group, std::vector<std::pair<size_t, size_t>>& began,
+    std::vector<std::pair<size_t, size_t>>& ended) {
+  Entry& entry = entries_[id];
+  BoundingBox world = Shift(entry.box, groups_[entry.group].offset);
+  // Scratch lists, kept per thread across calls.
+  thread_local std::vector<size_t> found;
+  thread_local std::vector<size_t> candidates;
+  thread_local std::vector<size_t> kept;
+  thread_local std::vector<size_t> old;
+  found.clear();
+  for (size_t index = 0; index < groups_.size(); ++index) {
+    if (index == entry.group && !own_group) {
+      continue;
+    }
+    const Group& group = groups_[index];
+    candidates.clear();
+    Collect(group, Shift(world, -group.offset), candidates);
+    for (size_t other : candidates) {
+      // Compared in world coordinates from either side, so the pair's
+      // two checks agree.
+      if (other != id &&
+          Shift(entries_[other].box, group.offset).Overlaps(world)) {
+        found.push_back(other);
+      }
+    }
+  }
+  std::sort(found.begin(), found.end());
+  found.erase(std::unique(found.begin(), found.end()), found.end());
+
+  // Partners in the same group are out of scope for a group-only check
+  // and are kept as they are.
+  kept.clear();
+  old.clear();
+  for (size_t partner : entry.partners) {
+    if (!own_group && entries_[partner].group == entry.group) {
+      kept.push_back(partner);
+    } else {
+      old.push_back(partner);
+    }
+  }
+  size_t old_pos = 0;
+  size_t new_pos = 0;
+  while (old_pos < old.size() || new_pos < found.size()) {
+    if (new_pos == found.size() ||
+        (old_pos < old.size() && old[old_pos] < found[new_pos])) {
+      EraseSorted(entries_[old[old_pos]].partners, id);
+      ended.push_back(MakePair(id, old[old_pos]));
+      ++old_pos;
+    } else if (old_pos == old.size() || found[new_pos] < old[old_pos]) {
+      InsertSorted(entries_[found[new_pos]].partners, id);
+      began.push_back(MakePair(id, found[new_pos]));
+      ++new_pos;
+    } else {
+      ++old_pos;
+      ++new_pos;
+    }
+  }
+  entry.partners.clear();
+  std::merge(kept.begin(), kept.end(), found.begin(), found.end(),
+             std::back_inserter(entry.partners));
+}
+
+void DynamicShapeGrid::UpdatePairs(
+    std::vector<std::pair<size_t, size_t>>& began,
+    std::vector<std::pair<size_t, size_t>>& ended) {
+  began.clear();
+  ended.clear();
+  ended.swap(removed_pairs_);
+  // An id may be listed twice if it was removed and reused; its flag is
+  // cleared by the first check.
+  for (size_t id : dirty_) {
+    if (entries_[id].shape != nullptr && entries_[id].dirty) {
+      entries_[id].dirty = false;
+      CheckPairs(id, true, began, ended);
+    }
+  }
+  dirty_.clear();
+  for (size_t group : moved_groups_) {
+    groups_[group].moved = false;
+    for (size_t id : groups_[group].members) {
+      CheckPairs(id, false, began, ended);
+    }
+  }
+  moved_groups_.clear();
+  std::sort(began.begin(), began.end());
+  std::sort(ended.begin(), ended.end());
+}
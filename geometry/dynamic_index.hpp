@@ -0,0 +1,137 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "geometry.hpp"
+
+// Loose grid over moving shapes owned by the caller, for broad-phase
+// collision tests that run every tick. Each shape is registered under its
+// bounding box widened by a margin, so a Move that keeps the box inside
+// that fattened box touches no cell.
+//
+// Shapes belong to groups. A shape's coordinates are relative to its
+// group's offset, and each group has its own grid in those coordinates:
+// MoveGroup translates a whole group in O(1) by changing the offset, never
+// calling IShape::Move. Queries and pairs are in world coordinates, the
+// shape translated by its offset; offsets plus coordinates must stay in
+// range.
+//
+// UpdatePairs reports the pairs whose world bounding boxes started or
+// stopped overlapping, re-examining only the shapes inserted or moved
+// since the last call and, against other groups, the members of moved
+// groups. Pairs within a group do not change when the group moves.
+class DynamicShapeGrid {
+ public:
+  explicit DynamicShapeGrid(int64_t cell_size = 64, int64_t margin = 16);
+
+  // Group 0 exists from the start.
+  size_t AddGroup(const Vector& offset = Vector());
+
+  size_t GroupCount() const { return groups_.size(); }
+
+  Vector GetOffset(size_t group) const;
+
+  void MoveGroup(size_t group, const Vector& vector);
+
+  // Returns an id for Move and Remove. Ids of removed shapes are reused.
+  size_t Insert(IShape* shape, size_t group = 0);
+
+  // Returns false if the id is not in the index. Its pairs are reported as
+  // ended by the next UpdatePairs.
+  bool Remove(size_t id);
+
+  // Calls shape->Move(vector) and updates the index.
+  void Move(size_t id, const Vector& vector);
+
+  IShape* GetShape(size_t id) const;
+
+  size_t GetGroup(size_t id) const;
+
+  std::vector<size_t> QueryContains(const Point& point) const;
+
+  std::vector<size_t> QueryCrossing(const Segment& segment) const;
+
+  // Replaces the contents of 'began' and 'ended' with the pairs (i, j),
+  // i < j, sorted, that changed since the last call.
+  void UpdatePairs(std::vector<std::pair<size_t, size_t>>& began,
+                   std::vector<std::pair<size_t, size_t>>& ended);
+
+  size_t Size() const { return size_; }
+
+ private:
+  struct Cell {
+    int64_t column;
+    int64_t row;
+
+    bool operator==(const Cell& other) const {
+      return column == other.column && row == other.row;
+    }
+  };
+
+  struct CellHash {
+    size_t operator()(const Cell& cell) const {
+      uint64_t hash = static_cast<uint64_t>(cell.column) * 0x9E3779B97F4A7C15;
+      return hash ^ (static_cast<uint64_t>(cell.row) + (hash >> 29));
+    }
+  };
+
+  using CellMap = std::unordered_map<Cell, std::vector<size_t>, CellHash>;
+
+  // 'box' is the shape's own box and 'fat_box' the one it is registered
+  // under, both in group coordinates. 'partners' is sorted.
+  struct Entry {
+    IShape* shape = nullptr;
+    size_t group = 0;
+    size_t slot = 0;
+    BoundingBox box;
+    BoundingBox fat_box;
+    bool large = false;
+    bool dirty = false;
+    Cell min_cell{0, 0};
+    Cell max_cell{0, 0};
+    std::vector<size_t> partners;
+  };
+
+  struct Group {
+    Vector offset;
+    bool moved = false;
+    std::vector<size_t> members;
+    CellMap cells;
+    std::vector<size_t> large;
+  };
+
+  // A shape spanning more cells than this goes to the large list.
+  static const int64_t kMaxCellsPerShape = 1024;
+
+  int64_t CellOf(int64_t coord) const;
+
+  const Entry& EntryAt(size_t id) const;
+
+  void Place(size_t id);
+
+  void Unplace(size_t id);
+
+  // The ids registered in 'group' under a box that may overlap 'box',
+  // given in that group's coordinates. May hold duplicates.
+  void Collect(const Group& group, const BoundingBox& box,
+               std::vector<size_t>& ids) const;
+
+  // Recomputes the pairs of 'id', against its own group only if
+  // 'own_group' is set.
+  void CheckPairs(size_t id, bool own_group,
+                  std::vector<std::pair<size_t, size_t>>& began,
+                  std::vector<std::pair<size_t, size_t>>& ended);
+
+  int64_t cell_size_;
+  int64_t margin_;
+  size_t size_ = 0;
+  std::vector<Group> groups_;
+  std::vector<Entry> entries_;
+  std::vector<size_t> free_ids_;
+  std::vector<size_t> dirty_;
+  std::vector<size_t> moved_groups_;
+  std::vector<std::pair<size_t, size_t>> removed_pairs_;
+};
@@ -1,93 +1,103 @@
 #include "geometry.hpp"
-
-#include <iostream>
-
-Vector::Vector() : xcord_(0), ycord_(0) {}
-
-Vector::Vector(int64_t xcord, int64_t ycord) : xcord_(xcord), ycord_(ycord) {}
-
-Vector::Vector(const Point& point)
-    : xcord_(point.GetX()), ycord_(point.GetY()) {}
-
-Vector::Vector(const Vector& right)
-    : xcord_(right.xcord_), ycord_(right.ycord_) {}
-
-Vector& Vector::operator=(const Vector& right) {
-  xcord_ = right.xcord_;
-  ycord_ = right.ycord_;
-  return *this;
-}
-
-int64_t Vector::operator*(const Vector& right) const {
-  int64_t scalar = (xcord_ * right.xcord_) + (ycord_ * right.ycord_);
-  return scalar;
-}
-
-Vector& Vector::operator+=(const Vector& right) {
-  xcord_ += right.xcord_;
-  ycord_ += right.ycord_;
-  return *this;
-}
-
-Vector& Vector::operator-=(const Vector& right) {
-  xcord_ -= right.xcord_;
-  ycord_ -= right.ycord_;
-  return *this;
-}
-
-Vector Vector::operator-() const {
-  Vector copy = *this;
-  copy.xcord_ = -xcord_;
-  copy.ycord_ = -ycord_;
-  return copy;
-}
-
-Vector& Vector::operator*=(int64_t num) {
-  xcord_ *= num;
-  ycord_ *= num;
-  return *this;
-}
-
-Vector operator*(Vector vect, const int64_t& num) {
-  vect *= num;
-  return vect;
-}
-
-Vector operator*(const int64_t& num, Vector vect) {
-  vect *= num;
-  return vect;
-}
-
-int64_t Vector::GetX() const { return xcord_; }
-
-int64_t Vector::GetY() const { return ycord_; }
-
-Vector operator+(Vector left, const Vector& right) {
-  left += right;
-  return left;
-}
-
-Vector operator-(Vector left, const Vector& right) {
-  left -= right;
-  return left;
-}
-
-int64_t operator^(const Vector& left, const Vector& right) {
-  int64_t result = left.GetX() * right.GetY() - left.GetY() * right.GetX();
-  return result;
-}
-
-bool operator==(const Vector& right, const Vector& left) {
-  return (right.GetX() == left.GetX() && right.GetY() == left.GetY());
-}
-
-IShape::~IShape() {}
-
-Point operator-(Point left, const Point& right) {
-  left -= right;
-  return left;
-}
-
-bool Crossfunct(const Segment& segment, const Point& point) {
-  return segment.ContainsPoint(point);
-}
+#include "prepared.hpp"
+
+#include <type_traits>
+
+// Everything is defined in the header; these checks keep the arithmetic
+// and the predicates usable in constant expressions.
+
+static_assert(std::is_trivially_copyable_v<Vector>);
+static_assert(std::is_trivially_copyable_v<BoundingBox>);
+static_assert(std::is_trivially_copy_constructible_v<Vector>);
+
+static_assert((Vector(1, 2) ^ Vector(3, 4)) == -2);
+static_assert(Vector(1, 2) * Vector(3, 4) == 11);
+static_assert(Vector(1, 2) + Vector(3, 4) == Vector(4, 6));
+static_assert(-Vector(1, 2) == Vector(-1, -2));
+static_assert(2 * Vector(1, 2) == Vector(2, 4));
+static_assert(Vector(Point(5, 7) - Point(2, 3)) == Vector(3, 4));
+
+static_assert(CrossSign(Vector(int64_t(1) << 40, 1),
+                        Vector(int64_t(1) << 40, 2)) == 1);
+static_assert(DotSign(Vector(-(int64_t(1) << 40), 0),
+                      Vector(int64_t(1) << 40, 0)) == -1);
+static_assert(CompareProducts(~static_cast<unsigned __int128>(0), 2,
+                              ~static_cast<unsigned __int128>(0), 1) == 1);
+static_assert(SaturatingAdd(BoundingBox::kMax, 1) == BoundingBox::kMax);
+static_assert(SaturatingSub(BoundingBox::kMin, 1) == BoundingBox::kMin);
+
+static_assert(Point(1, 2).ContainsPoint(Point(1, 2)));
+static_assert(Segment(Point(0, 0), Point(4, 4)).ContainsPoint(Point(2, 2)));
+static_assert(!Segment(Point(0, 0), Point(4, 4)).ContainsPoint(Point(5, 5)));
+static_assert(Segment(Point(0, 0), Point(4, 4))
+                  .CrossSegment(Segment(Point(0, 4), Point(4, 0))));
+static_assert(Segment(Point(0, 0), Point(4, 0))
+                  .CrossSegment(Segment(Point(4, 0), Point(6, 0))));
+static_assert(!Segment(Point(0, 0), Point(4, 0))
+                   .CrossSegment(Segment(Point(5, 0), Point(6, 0))));
+static_assert(Line(Point(0, 0), Point(1, 1)).ContainsPoint(Point(-3, -3)));
+static_assert(Line(Point(0, 0), Point(1, 0))
+                  .CrossSegment(Segment(Point(5, -1), Point(5, 1))));
+static_assert(Ray(Point(0, 0), Point(1, 0)).ContainsPoint(Point(9, 0)));
+static_assert(!Ray(Point(0, 0), Point(1, 0)).ContainsPoint(Point(-1, 0)));
+static_assert(Ray(Point(0, 0), Point(1, 0))
+                  .CrossSegment(Segment(Point(5, -1), Point(5, 1))));
+static_assert(!Ray(Point(0, 0), Point(1, 0))
+                   .CrossSegment(Segment(Point(-5, -1), Point(-5, 1))));
+static_assert(Circle(Point(0, 0), 5).ContainsPoint(Point(3, 4)));
+static_assert(!Circle(Point(0, 0), 5).ContainsPoint(Point(4, 4)));
+static_assert(Circle(Point(0, 0), 5)
+                  .CrossSegment(Segment(Point(-9, 3), Point(9, 3))));
+static_assert(!Circle(Point(0, 0), 5)
+                   .CrossSegment(Segment(Point(-1, 1), Point(1, 1))));
+static_assert(Ray(Point(0, 0), Point(1, 1)).GetBoundingBox().min_x == 0);
+
+// The compact and floating instantiations.
+template class BasicPoint<int32_t>;
+template class BasicSegment<int32_t>;
+template class BasicLine<int32_t>;
+template class BasicRay<int32_t>;
+template class BasicCircle<int32_t>;
+template class BasicPoint<double>;
+template class BasicSegment<double>;
+template class BasicLine<double>;
+template class BasicRay<double>;
+template class BasicCircle<double>;
+
+using Point32 = BasicPoint<int32_t>;
+using Segment32 = BasicSegment<int32_t>;
+using PointF = BasicPoint<double>;
+using SegmentF = BasicSegment<double>;
+
+static_assert(sizeof(BasicVector<int32_t>) == 8);
+static_assert(CrossSign(BasicVector<int32_t>(1 << 29, -(1 << 29)),
+                        BasicVector<int32_t>(1 << 29, (1 << 29) - 1)) == 1);
+static_assert(Segment32(Point32(-(1 << 29), -(1 << 29)),
+                        Point32(1 << 29, 1 << 29))
+                  .CrossSegment(Segment32(Point32(-(1 << 29), 1 << 29),
+                                          Point32(1 << 29, -(1 << 29)))));
+static_assert(BasicCircle<int32_t>(Point32(0, 0), 5)
+                  .ContainsPoint(Point32(3, 4)));
+static_assert(BasicCircle<int32_t>(Point32(0, 0), 5)
+                  .CrossSegment(Segment32(Point32(-9, 5), Point32(9, 5))));
+static_assert(!BasicCircle<int32_t>(Point32(0, 0), 5)
+                   .CrossSegment(Segment32(Point32(-9, 6), Point32(9, 6))));
+
+static_assert(PointF(0.1 + 0.2, 1).ContainsPoint(PointF(0.3, 1)));
+static_assert(SegmentF(PointF(0, 0), PointF(0.3, 0.3))
+                  .ContainsPoint(PointF(0.1, 0.1)));
+static_assert(BasicLine<double>(PointF(0, 0), PointF(3, 1))
+                  .ContainsPoint(PointF(0.3, 0.1)));
+static_assert(!BasicLine<double>(PointF(0, 0), PointF(3, 1))
+                   .ContainsPoint(PointF(0.3, 0.1001)));
+static_assert(BasicCircle<double>(PointF(0, 0), 0.5)
+                  .ContainsPoint(PointF(0.3, 0.4)));
+
+static_assert(PreparedRay(Ray(Point(0, 0), Point(1, 1)))
+                  .CrossSegment(Segment(Point(5, 0), Point(0, 5))));
+static_assert(!PreparedRay(Ray(Point(0, 0), Point(1, 1)))
+                   .CrossSegment(Segment(Point(-5, 0), Point(0, -4))));
+static_assert(PreparedCircle(Circle(Point(0, 0), 5))
+                  .ContainsPoint(Point(3, 4)));
+static_assert(PreparedSegment(Segment(Point(0, 0), Point(4, 2)))
+                  .ContainsPoint(Point(2, 1)));
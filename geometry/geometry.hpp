@@ -1,148 +1,515 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
+#include <limits>
+#include <type_traits>
+
+#include "shape_arena.hpp"
+
+// Arithmetic behind the predicates for each coordinate type. Wide holds a
+// product of two coordinate differences and Square a squared length, so
+// the integer instantiations stay exact: int32_t coordinates below 2^30
+// (differences fit in int32_t) and int64_t coordinates below 2^62.
+// Floating types compare with a relative tolerance of kEpsilon instead.
+template <typename Coord>
+struct CoordTraits;
+
+template <>
+struct CoordTraits<int32_t> {
+  using Wide = int64_t;
+  using Square = uint64_t;
+  using Radius = uint32_t;
+  static constexpr bool kExact = true;
+};
 
-class Vector;
+template <>
+struct CoordTraits<int64_t> {
+  using Wide = __int128;
+  using Square = unsigned __int128;
+  using Radius = size_t;
+  static constexpr bool kExact = true;
+};
 
-class IShape;
+template <>
+struct CoordTraits<float> {
+  using Wide = double;
+  using Square = double;
+  using Radius = float;
+  static constexpr bool kExact = false;
+  static constexpr double kEpsilon = 1e-5;
+};
 
-class Point;
+template <>
+struct CoordTraits<double> {
+  using Wide = double;
+  using Square = double;
+  using Radius = double;
+  static constexpr bool kExact = false;
+  static constexpr double kEpsilon = 1e-9;
+};
 
-class Segment;
+template <typename Coord>
+class BasicPoint;
 
-class Vector {
- private:
-  int64_t xcord_;
-  int64_t ycord_;
+template <typename Coord>
+class BasicSegment;
 
- public:
-  Vector();
+template <typename Coord>
+class BasicLine;
 
-  Vector(int64_t, int64_t);
+template <typename Coord>
+class BasicRay;
 
-  Vector(const Vector&);
+template <typename Coord>
+class BasicCircle;
 
-  Vector(const Point&);
+// The shapes' destructors do nothing, so an arena frees them without
+// running them.
+template <typename Coord>
+constexpr bool kArenaSkipsDestructor<BasicPoint<Coord>> = true;
 
-  Vector& operator=(const Vector&);
+template <typename Coord>
+constexpr bool kArenaSkipsDestructor<BasicSegment<Coord>> = true;
 
-  int64_t operator*(const Vector&) const;
+template <typename Coord>
+constexpr bool kArenaSkipsDestructor<BasicLine<Coord>> = true;
 
-  Vector& operator+=(const Vector&);
+template <typename Coord>
+constexpr bool kArenaSkipsDestructor<BasicRay<Coord>> = true;
 
-  Vector& operator-=(const Vector&);
+template <typename Coord>
+constexpr bool kArenaSkipsDestructor<BasicCircle<Coord>> = true;
 
-  Vector operator-() const;
+template <typename Coord>
+class BasicVector {
+ private:
+  Coord xcord_;
+  Coord ycord_;
 
-  Vector& operator*=(int64_t);
+ public:
+  constexpr BasicVector() : xcord_(0), ycord_(0) {}
 
-  int64_t GetX() const;
+  constexpr BasicVector(Coord xcord, Coord ycord)
+      : xcord_(xcord), ycord_(ycord) {}
 
-  int64_t GetY() const;
+  constexpr BasicVector(const BasicPoint<Coord>&);
 
-  ~Vector() {}
-};
+  constexpr Coord operator*(const BasicVector& right) const {
+    return (xcord_ * right.xcord_) + (ycord_ * right.ycord_);
+  }
 
-int64_t operator^(const Vector&, const Vector&);
+  constexpr BasicVector& operator+=(const BasicVector& right) {
+    xcord_ += right.xcord_;
+    ycord_ += right.ycord_;
+    return *this;
+  }
 
-Vector operator*(Vector vect, const int64_t& num);
+  constexpr BasicVector& operator-=(const BasicVector& right) {
+    xcord_ -= right.xcord_;
+    ycord_ -= right.ycord_;
+    return *this;
+  }
 
-Vector operator*(const int64_t& num, Vector vect);
+  constexpr BasicVector operator-() const {
+    return BasicVector(-xcord_, -ycord_);
+  }
 
-Vector operator+(Vector left, const Vector& right);
+  constexpr BasicVector& operator*=(Coord num) {
+    xcord_ *= num;
+    ycord_ *= num;
+    return *this;
+  }
 
-Vector operator-(Vector left, const Vector& right);
+  constexpr Coord GetX() const { return xcord_; }
 
-bool operator==(const Vector& right, const Vector& left);
+  constexpr Coord GetY() const { return ycord_; }
+};
 
-bool Crossfunct(const Segment& segment, const Point& point);
+template <typename Coord>
+constexpr Coord operator^(const BasicVector<Coord>& left,
+                          const BasicVector<Coord>& right) {
+  return left.GetX() * right.GetY() - left.GetY() * right.GetX();
+}
+
+template <typename Coord>
+constexpr BasicVector<Coord> operator*(BasicVector<Coord> vect,
+                                       const std::type_identity_t<Coord>& num) {
+  vect *= num;
+  return vect;
+}
+
+template <typename Coord>
+constexpr BasicVector<Coord> operator*(const std::type_identity_t<Coord>& num,
+                                       BasicVector<Coord> vect) {
+  vect *= num;
+  return vect;
+}
+
+template <typename Coord>
+constexpr BasicVector<Coord> operator+(BasicVector<Coord> left,
+                                       const BasicVector<Coord>& right) {
+  left += right;
+  return left;
+}
+
+template <typename Coord>
+constexpr BasicVector<Coord> operator-(BasicVector<Coord> left,
+                                       const BasicVector<Coord>& right) {
+  left -= right;
+  return left;
+}
+
+template <typename Coord>
+constexpr bool operator==(const BasicVector<Coord>& right,
+                          const BasicVector<Coord>& left) {
+  return (right.GetX() == left.GetX() && right.GetY() == left.GetY());
+}
+
+template <typename Coord>
+constexpr bool Crossfunct(const BasicSegment<Coord>& segment,
+                          const BasicPoint<Coord>& point);
+
+// Sign of left - right. Floating types treat values within kEpsilon of
+// each other, relative to the larger magnitude, as equal.
+template <typename Coord, typename Value>
+constexpr int CompareValues(Value left, Value right) {
+  if constexpr (CoordTraits<Coord>::kExact) {
+    return (left > right) - (left < right);
+  } else {
+    Value scale = std::max(left < 0 ? -left : left, right < 0 ? -right : right);
+    Value tolerance = CoordTraits<Coord>::kEpsilon * scale;
+    return (left - right > tolerance) - (right - left > tolerance);
+  }
+}
+
+// int64_t vectors with components below 2^31 take the int64_t path; larger
+// ones are widened to __int128 after that cheap magnitude check.
+constexpr bool FitsHalfWord(int64_t value) {
+  const uint64_t kLimit = (uint64_t(1) << 31) - 1;
+  return static_cast<uint64_t>(value) + kLimit <= 2 * kLimit;
+}
+
+constexpr bool FitsHalfWord(const BasicVector<int64_t>& vect) {
+  return FitsHalfWord(vect.GetX()) && FitsHalfWord(vect.GetY());
+}
+
+constexpr int Sign(__int128 value) { return (value > 0) - (value < 0); }
+
+template <typename Coord>
+constexpr typename CoordTraits<Coord>::Wide WideCross(
+    const BasicVector<Coord>& left, const BasicVector<Coord>& right) {
+  using Wide = typename CoordTraits<Coord>::Wide;
+  return static_cast<Wide>(left.GetX()) * right.GetY() -
+         static_cast<Wide>(left.GetY()) * right.GetX();
+}
+
+template <typename Coord>
+constexpr typename CoordTraits<Coord>::Wide WideDot(
+    const BasicVector<Coord>& left, const BasicVector<Coord>& right) {
+  using Wide = typename CoordTraits<Coord>::Wide;
+  return static_cast<Wide>(left.GetX()) * right.GetX() +
+         static_cast<Wide>(left.GetY()) * right.GetY();
+}
+
+template <typename Coord>
+constexpr int CrossSign(const BasicVector<Coord>& left,
+                        const BasicVector<Coord>& right) {
+  using Wide = typename CoordTraits<Coord>::Wide;
+  if constexpr (std::is_same_v<Coord, int64_t>) {
+    if (FitsHalfWord(left) && FitsHalfWord(right)) {
+      return Sign(left ^ right);
+    }
+  }
+  return CompareValues<Coord>(static_cast<Wide>(left.GetX()) * right.GetY(),
+                              static_cast<Wide>(left.GetY()) * right.GetX());
+}
+
+template <typename Coord>
+constexpr int DotSign(const BasicVector<Coord>& left,
+                      const BasicVector<Coord>& right) {
+  using Wide = typename CoordTraits<Coord>::Wide;
+  if constexpr (std::is_same_v<Coord, int64_t>) {
+    if (FitsHalfWord(left) && FitsHalfWord(right)) {
+      return Sign(left * right);
+    }
+  }
+  return CompareValues<Coord>(static_cast<Wide>(left.GetX()) * right.GetX(),
+                              -(static_cast<Wide>(left.GetY()) * right.GetY()));
+}
+
+// Exact for any integer components.
+template <typename Coord>
+constexpr typename CoordTraits<Coord>::Square SquaredLength(
+    const BasicVector<Coord>& vect) {
+  using Square = typename CoordTraits<Coord>::Square;
+  if constexpr (CoordTraits<Coord>::kExact) {
+    using Unsigned = std::make_unsigned_t<Coord>;
+    Unsigned xabs = vect.GetX() < 0 ? 0 - static_cast<Unsigned>(vect.GetX())
+                                    : static_cast<Unsigned>(vect.GetX());
+    Unsigned yabs = vect.GetY() < 0 ? 0 - static_cast<Unsigned>(vect.GetY())
+                                    : static_cast<Unsigned>(vect.GetY());
+    return static_cast<Square>(xabs) * xabs + static_cast<Square>(yabs) * yabs;
+  } else {
+    return static_cast<Square>(vect.GetX()) * vect.GetX() +
+           static_cast<Square>(vect.GetY()) * vect.GetY();
+  }
+}
+
+template <typename Coord>
+constexpr typename CoordTraits<Coord>::Square AbsWide(
+    typename CoordTraits<Coord>::Wide value) {
+  using Square = typename CoordTraits<Coord>::Square;
+  return value < 0 ? 0 - static_cast<Square>(value)
+                   : static_cast<Square>(value);
+}
+
+// Full 256-bit product as (high, low) 128-bit halves.
+constexpr void MultiplyWide(unsigned __int128 left, unsigned __int128 right,
+                            unsigned __int128& high, unsigned __int128& low) {
+  const unsigned __int128 kMask = ~uint64_t(0);
+  unsigned __int128 left_low = left & kMask;
+  unsigned __int128 left_high = left >> 64;
+  unsigned __int128 right_low = right & kMask;
+  unsigned __int128 right_high = right >> 64;
+  unsigned __int128 low_low = left_low * right_low;
+  unsigned __int128 high_low = left_high * right_low;
+  unsigned __int128 low_high = left_low * right_high;
+  unsigned __int128 middle = (low_low >> 64) + (high_low & kMask) +
+                             (low_high & kMask);
+  low = (middle << 64) | (low_low & kMask);
+  high = left_high * right_high + (high_low >> 64) + (low_high >> 64) +
+         (middle >> 64);
+}
+
+// Sign of left_a * left_b - right_a * right_b, compared over 256 bits.
+constexpr int CompareProducts(unsigned __int128 left_a,
+                              unsigned __int128 left_b,
+                              unsigned __int128 right_a,
+                              unsigned __int128 right_b) {
+  unsigned __int128 left_high = 0;
+  unsigned __int128 left_low = 0;
+  unsigned __int128 right_high = 0;
+  unsigned __int128 right_low = 0;
+  MultiplyWide(left_a, left_b, left_high, left_low);
+  MultiplyWide(right_a, right_b, right_high, right_low);
+  if (left_high != right_high) {
+    return left_high < right_high ? -1 : 1;
+  }
+  return (left_low > right_low) - (left_low < right_low);
+}
+
+// The same for squared magnitudes of Coord: 64-bit squares multiply into
+// unsigned __int128, 128-bit ones need the 256-bit comparison.
+template <typename Coord,
+          typename Square = typename CoordTraits<Coord>::Square>
+constexpr int CompareSquareProducts(Square left_a, Square left_b,
+                                    Square right_a, Square right_b) {
+  if constexpr (std::is_same_v<Square, unsigned __int128>) {
+    return CompareProducts(left_a, left_b, right_a, right_b);
+  } else if constexpr (CoordTraits<Coord>::kExact) {
+    return CompareValues<Coord>(
+        static_cast<unsigned __int128>(left_a) * left_b,
+        static_cast<unsigned __int128>(right_a) * right_b);
+  } else {
+    return CompareValues<Coord>(left_a * left_b, right_a * right_b);
+  }
+}
+
+// Axis-aligned box with inclusive bounds. An unbounded side sits at the
+// limit of Coord, so a Line or Ray gets the slab or quadrant it lies in.
+template <typename Coord>
+struct BasicBoundingBox {
+  static constexpr Coord kMin = std::numeric_limits<Coord>::lowest();
+  static constexpr Coord kMax = std::numeric_limits<Coord>::max();
+
+  Coord min_x = kMin;
+  Coord min_y = kMin;
+  Coord max_x = kMax;
+  Coord max_y = kMax;
+
+  constexpr bool Overlaps(const BasicBoundingBox& other) const {
+    return min_x <= other.max_x && other.min_x <= max_x &&
+           min_y <= other.max_y && other.min_y <= max_y;
+  }
 
-class IShape {
+  constexpr bool Contains(Coord xcord, Coord ycord) const {
+    return min_x <= xcord && xcord <= max_x && min_y <= ycord &&
+           ycord <= max_y;
+  }
+
+  constexpr bool IsFinite() const {
+    return min_x != kMin && min_y != kMin && max_x != kMax && max_y != kMax;
+  }
+};
+
+// Clamped to the range of Coord.
+template <typename Coord>
+constexpr Coord SaturatingAdd(Coord left, std::type_identity_t<Coord> right) {
+  if constexpr (std::is_floating_point_v<Coord>) {
+    return left + right;
+  } else {
+    Coord result = 0;
+    if (__builtin_add_overflow(left, right, &result)) {
+      return right > 0 ? BasicBoundingBox<Coord>::kMax
+                       : BasicBoundingBox<Coord>::kMin;
+    }
+    return result;
+  }
+}
+
+template <typename Coord>
+constexpr Coord SaturatingSub(Coord left, std::type_identity_t<Coord> right) {
+  if constexpr (std::is_floating_point_v<Coord>) {
+    return left - right;
+  } else {
+    Coord result = 0;
+    if (__builtin_sub_overflow(left, right, &result)) {
+      return right < 0 ? BasicBoundingBox<Coord>::kMax
+                       : BasicBoundingBox<Coord>::kMin;
+    }
+    return result;
+  }
+}
+
+enum class ShapeKind { kPoint, kSegment, kLine, kRay, kCircle, kPolygon };
+
+// Shapes are literal types: their predicates are constexpr and usable in
+// constant expressions.
+template <typename Coord>
+class BasicShape {
  public:
-  virtual void Move(const Vector&) = 0;
+  virtual ShapeKind GetKind() const = 0;
+
+  virtual void Move(const BasicVector<Coord>&) = 0;
+
+  virtual bool ContainsPoint(const BasicPoint<Coord>&) const = 0;
+
+  virtual bool CrossSegment(const BasicSegment<Coord>&) const = 0;
 
-  virtual bool ContainsPoint(const Point&) const = 0;
+  virtual BasicBoundingBox<Coord> GetBoundingBox() const = 0;
 
-  virtual bool CrossSegment(const Segment&) const = 0;
+  virtual BasicShape* Clone() const = 0;
 
-  virtual IShape* Clone() const = 0;
+  // The same copy, placed in 'arena' and owned by it: it must not be
+  // deleted, and lives until the arena is cleared.
+  virtual BasicShape* CloneInto(ShapeArena& arena) const = 0;
 
-  virtual ~IShape() = 0;
+  virtual constexpr ~BasicShape() = default;
 };
 
-class Point : public IShape {
+template <typename Coord>
+class BasicPoint : public BasicShape<Coord> {
  private:
-  int64_t xcord_;
-  int64_t ycord_;
+  using Vector = BasicVector<Coord>;
+  using Segment = BasicSegment<Coord>;
+  using BoundingBox = BasicBoundingBox<Coord>;
+  using IShape = BasicShape<Coord>;
+
+  Coord xcord_;
+  Coord ycord_;
 
  public:
-  Point(int64_t xcord, int64_t ycord) : xcord_(xcord), ycord_(ycord) {}
+  constexpr BasicPoint(Coord xcord, Coord ycord)
+      : xcord_(xcord), ycord_(ycord) {}
 
-  Point(const Point& right) : xcord_(right.xcord_), ycord_(right.ycord_) {}
+  constexpr BasicPoint(const Vector& vector)
+      : xcord_(vector.GetX()), ycord_(vector.GetY()) {}
 
-  Point(const Vector& vector) : xcord_(vector.GetX()), ycord_(vector.GetY()) {}
+  constexpr BasicPoint(const BasicPoint&) = default;
 
-  Point& operator=(const Point& right) {
-    xcord_ = right.xcord_;
-    ycord_ = right.ycord_;
-    return *this;
-  }
+  constexpr BasicPoint& operator=(const BasicPoint&) = default;
+
+  constexpr ShapeKind GetKind() const override { return ShapeKind::kPoint; }
 
-  Point& operator+=(const Vector& vector) {
+  constexpr BasicPoint& operator+=(const Vector& vector) {
     xcord_ += vector.GetX();
     ycord_ += vector.GetY();
     return *this;
   }
 
-  Point& operator-=(const Point& right) {
+  constexpr BasicPoint& operator-=(const BasicPoint& right) {
     xcord_ -= right.xcord_;
     ycord_ -= right.ycord_;
     return *this;
   }
 
-  int64_t GetX() const { return xcord_; }
+  constexpr Coord GetX() const { return xcord_; }
 
-  int64_t GetY() const { return ycord_; }
+  constexpr Coord GetY() const { return ycord_; }
 
-  void Move(const Vector& vector) override {
+  constexpr void Move(const Vector& vector) override {
     xcord_ += vector.GetX();
     ycord_ += vector.GetY();
   }
 
-  bool ContainsPoint(const Point& point) const override {
-    return (xcord_ == point.xcord_ && ycord_ == point.ycord_);
+  constexpr bool ContainsPoint(const BasicPoint& point) const override {
+    return CompareValues<Coord>(xcord_, point.xcord_) == 0 &&
+           CompareValues<Coord>(ycord_, point.ycord_) == 0;
   }
 
-  bool CrossSegment(const Segment& segment) const override {
+  constexpr bool CrossSegment(const Segment& segment) const override {
     return Crossfunct(segment, *this);
   }
 
+  constexpr BoundingBox GetBoundingBox() const override {
+    return BoundingBox{xcord_, ycord_, xcord_, ycord_};
+  }
+
   IShape* Clone() const override {
-    Point* clone = new Point(xcord_, ycord_);
+    BasicPoint* clone = new BasicPoint(xcord_, ycord_);
     return clone;
   };
 
-  ~Point() {}
+  IShape* CloneInto(ShapeArena& arena) const override {
+    return arena.Create<BasicPoint>(xcord_, ycord_);
+  }
+
+  constexpr ~BasicPoint() {}
 };
 
-Point operator-(Point left, const Point& right);
+template <typename Coord>
+constexpr BasicVector<Coord>::BasicVector(const BasicPoint<Coord>& point)
+    : xcord_(point.GetX()), ycord_(point.GetY()) {}
+
+template <typename Coord>
+constexpr BasicPoint<Coord> operator-(BasicPoint<Coord> left,
+                                      const BasicPoint<Coord>& right) {
+  left -= right;
+  return left;
+}
 
-class Segment : public IShape {
+template <typename Coord>
+class BasicSegment : public BasicShape<Coord> {
  private:
+  using Vector = BasicVector<Coord>;
+  using Point = BasicPoint<Coord>;
+  using BoundingBox = BasicBoundingBox<Coord>;
+  using IShape = BasicShape<Coord>;
+
   Point begin_;
   Point end_;
 
  public:
-  Segment(Point begin, Point end) : begin_(begin), end_(end) {}
+  constexpr BasicSegment(Point begin, Point end) : begin_(begin), end_(end) {}
+
+  constexpr ShapeKind GetKind() const override { return ShapeKind::kSegment; }
 
-  Point GetA() const { return begin_; }
+  constexpr Point GetA() const { return begin_; }
 
-  Point GetB() const { return end_; }
+  constexpr Point GetB() const { return end_; }
 
-  void Move(const Vector& vector) override {
+  constexpr void Move(const Vector& vector) override {
     begin_ += vector;
     end_ += vector;
   }
 
-  bool ContainsPoint(const Point& point) const override {
+  constexpr bool ContainsPoint(const Point& point) const override {
+    if (CoordTraits<Coord>::kExact &&
+        !GetBoundingBox().Contains(point.GetX(), point.GetY())) {
+      return false;
+    }
     Vector ab_vect((end_ - begin_).GetX(), (end_ - begin_).GetY());
     Vector ac_vect((point - begin_).GetX(), (point - begin_).GetY());
     Vector bc_vect((point - end_).GetX(), (point - end_).GetY());
@@ -150,11 +517,30 @@ class Segment : public IShape {
     if (ab_vect == ba_vect) {
       return point.ContainsPoint(begin_);
     }
-    return (ac_vect ^ ab_vect) == 0 && (ac_vect * ab_vect) >= 0 &&
-           (bc_vect * ba_vect) >= 0;
+    return CrossSign(ac_vect, ab_vect) == 0 && DotSign(ac_vect, ab_vect) >= 0 &&
+           DotSign(bc_vect, ba_vect) >= 0;
   }
 
-  bool CrossSegment(const Segment& segment) const override {
+  // Batch forms over structure-of-arrays input: out[i] is 1 if the i-th
+  // point (segment) passes the predicate and 0 otherwise.
+  void ContainsPoints(const Coord* xs, const Coord* ys, size_t count,
+                      uint8_t* out) const;
+
+  void CrossSegments(const Coord* ax, const Coord* ay, const Coord* bx,
+                     const Coord* by, size_t count, uint8_t* out) const;
+
+  constexpr BoundingBox GetBoundingBox() const override {
+    return BoundingBox{std::min(begin_.GetX(), end_.GetX()),
+                       std::min(begin_.GetY(), end_.GetY()),
+                       std::max(begin_.GetX(), end_.GetX()),
+                       std::max(begin_.GetY(), end_.GetY())};
+  }
+
+  constexpr bool CrossSegment(const BasicSegment& segment) const override {
+    if (CoordTraits<Coord>::kExact &&
+        !GetBoundingBox().Overlaps(segment.GetBoundingBox())) {
+      return false;
+    }
     Point a_p = begin_;
     Point b_p = end_;
     Point c_p = segment.begin_;
@@ -165,9 +551,9 @@ class Segment : public IShape {
     Vector ad_vect((d_p - a_p).GetX(), (d_p - a_p).GetY());
     Vector ca_vect = -ac_vect;
     Vector cb_vect((b_p - c_p).GetX(), (b_p - c_p).GetY());
-    if ((ab_vect ^ cd_vect) != 0) {
-      int64_t expr1 = (ab_vect ^ ac_vect) * (ab_vect ^ ad_vect);
-      int64_t expr2 = (cd_vect ^ ca_vect) * (cd_vect ^ cb_vect);
+    if (CrossSign(ab_vect, cd_vect) != 0) {
+      int expr1 = CrossSign(ab_vect, ac_vect) * CrossSign(ab_vect, ad_vect);
+      int expr2 = CrossSign(cd_vect, ca_vect) * CrossSign(cd_vect, cb_vect);
       return (expr1 <= 0 && expr2 <= 0);
     }
     if (this->ContainsPoint(c_p) || this->ContainsPoint(d_p)) {
@@ -177,42 +563,66 @@ class Segment : public IShape {
   }
 
   IShape* Clone() const override {
-    Segment* clone = new Segment(begin_, end_);
+    BasicSegment* clone = new BasicSegment(begin_, end_);
     return clone;
   }
 
-  ~Segment() {}
+  IShape* CloneInto(ShapeArena& arena) const override {
+    return arena.Create<BasicSegment>(begin_, end_);
+  }
+
+  constexpr ~BasicSegment() {}
 };
 
-class Line : public IShape {
+template <typename Coord>
+constexpr bool Crossfunct(const BasicSegment<Coord>& segment,
+                          const BasicPoint<Coord>& point) {
+  return segment.ContainsPoint(point);
+}
+
+template <typename Coord>
+class BasicLine : public BasicShape<Coord> {
  private:
+  using Vector = BasicVector<Coord>;
+  using Point = BasicPoint<Coord>;
+  using Segment = BasicSegment<Coord>;
+  using BoundingBox = BasicBoundingBox<Coord>;
+  using IShape = BasicShape<Coord>;
+
   Point first_;
   Point second_;
 
  public:
-  Line(Point first, Point second) : first_(first), second_(second) {}
+  constexpr BasicLine(Point first, Point second)
+      : first_(first), second_(second) {}
+
+  constexpr ShapeKind GetKind() const override { return ShapeKind::kLine; }
+
+  constexpr Point GetFirst() const { return first_; }
+
+  constexpr Point GetSecond() const { return second_; }
 
-  int64_t GetA() const { return (second_ - first_).GetY(); }
+  constexpr Coord GetA() const { return (second_ - first_).GetY(); }
 
-  int64_t GetB() const { return -(second_ - first_).GetX(); }
+  constexpr Coord GetB() const { return -(second_ - first_).GetX(); }
 
-  int64_t GetC() const {
-    int64_t result = (first_.GetY()) * (-GetB()) - (first_.GetX()) * GetA();
+  constexpr Coord GetC() const {
+    Coord result = (first_.GetY()) * (-GetB()) - (first_.GetX()) * GetA();
     return result;
   }
 
-  void Move(const Vector& vector) override {
+  constexpr void Move(const Vector& vector) override {
     first_ += vector;
     second_ += vector;
   }
 
-  bool ContainsPoint(const Point& point) const override {
+  constexpr bool ContainsPoint(const Point& point) const override {
     Vector ab_vect((second_ - first_).GetX(), (second_ - first_).GetY());
     Vector ac_vect((point - first_).GetX(), (point - first_).GetY());
-    return ((ac_vect ^ ab_vect) == 0);
+    return CrossSign(ac_vect, ab_vect) == 0;
   }
 
-  bool CrossSegment(const Segment& segment) const override {
+  constexpr bool CrossSegment(const Segment& segment) const override {
     Point a_p = first_;
     Point b_p = second_;
     Point c_p = segment.GetA();
@@ -220,45 +630,90 @@ class Line : public IShape {
     Vector ab_vect((b_p - a_p).GetX(), (b_p - a_p).GetY());
     Vector ac_vect((c_p - a_p).GetX(), (c_p - a_p).GetY());
     Vector ad_vect((d_p - a_p).GetX(), (d_p - a_p).GetY());
-    return ((ab_vect ^ ac_vect) * (ab_vect ^ ad_vect) <= 0);
+    return CrossSign(ab_vect, ac_vect) * CrossSign(ab_vect, ad_vect) <= 0;
+  }
+
+  void CrossSegments(const Coord* ax, const Coord* ay, const Coord* bx,
+                     const Coord* by, size_t count, uint8_t* out) const;
+
+  // A horizontal or vertical line is a slab; any other line, and a
+  // degenerate one, covers the whole plane.
+  constexpr BoundingBox GetBoundingBox() const override {
+    BoundingBox box;
+    Point direct = second_ - first_;
+    if (direct.GetX() == 0 && direct.GetY() == 0) {
+      return box;
+    }
+    if (direct.GetX() == 0) {
+      box.min_x = box.max_x = first_.GetX();
+    }
+    if (direct.GetY() == 0) {
+      box.min_y = box.max_y = first_.GetY();
+    }
+    return box;
   }
 
   IShape* Clone() const override {
-    Line* clone = new Line(first_, second_);
+    BasicLine* clone = new BasicLine(first_, second_);
     return clone;
   }
+
+  IShape* CloneInto(ShapeArena& arena) const override {
+    return arena.Create<BasicLine>(first_, second_);
+  }
+
+  constexpr ~BasicLine() {}
 };
 
-class Ray : public IShape {
+template <typename Coord>
+class BasicRay : public BasicShape<Coord> {
  private:
+  using Vector = BasicVector<Coord>;
+  using Point = BasicPoint<Coord>;
+  using Segment = BasicSegment<Coord>;
+  using Line = BasicLine<Coord>;
+  using BoundingBox = BasicBoundingBox<Coord>;
+  using IShape = BasicShape<Coord>;
+
   Point first_;
   Point second_;
 
  public:
-  Ray(Point first, Point second) : first_(first), second_(second) {}
+  constexpr BasicRay(Point first, Point second)
+      : first_(first), second_(second) {}
 
-  Point GetA() const { return first_; }
+  constexpr ShapeKind GetKind() const override { return ShapeKind::kRay; }
 
-  Vector GetVector() const {
+  constexpr Point GetA() const { return first_; }
+
+  constexpr Vector GetVector() const {
     Point forvect = second_ - first_;
     Vector direct(forvect.GetX(), forvect.GetY());
     return direct;
   };
 
-  void Move(const Vector& vector) override {
+  constexpr void Move(const Vector& vector) override {
     first_ += vector;
     second_ += vector;
   };
 
-  bool ContainsPoint(const Point& point) const override {
+  constexpr bool ContainsPoint(const Point& point) const override {
+    if (CoordTraits<Coord>::kExact &&
+        !GetBoundingBox().Contains(point.GetX(), point.GetY())) {
+      return false;
+    }
     Line tmp(first_, second_);
     bool online = tmp.ContainsPoint(point);
     Vector pvect((point - first_).GetX(), (point - first_).GetY());
     Vector rvect = this->GetVector();
-    return (online && (pvect * rvect >= 0));
+    return (online && DotSign(pvect, rvect) >= 0);
   }
 
-  bool CrossSegment(const Segment& segment) const override {
+  constexpr bool CrossSegment(const Segment& segment) const override {
+    if (CoordTraits<Coord>::kExact &&
+        !GetBoundingBox().Overlaps(segment.GetBoundingBox())) {
+      return false;
+    }
     Point a_p = segment.GetA();
     Point b_p = segment.GetB();
     Line line(first_, second_);
@@ -269,55 +724,119 @@ class Ray : public IShape {
     if (!(line.CrossSegment(segment))) {
       return false;
     }
+    // The crossing is at first_ + t * ray_vector with
+    // t = (start_to_seg * seg_normal) / (ray_vector * seg_normal); only the
+    // sign of t matters. A parallel segment crossing the line lies on it,
+    // and has neither end on the ray, so it is behind.
     Line seg_line(a_p, b_p);
     Vector seg_normal(seg_line.GetA(), seg_line.GetB());
-    Vector seg_start(a_p.GetX(), a_p.GetY());
-    Vector ray_start(first_.GetX(), first_.GetY());
+    Vector start_to_seg((a_p - first_).GetX(), (a_p - first_).GetY());
     Vector ray_vector = this->GetVector();
-    double seg_val = (seg_start * seg_normal);
-    double ray_start_to_norm = (ray_start * seg_normal);
-    double ray_to_norm = (ray_vector * seg_normal);
-    double intersection = (seg_val - ray_start_to_norm) / ray_to_norm;
-    return (intersection >= 0);
+    int ray_to_norm = DotSign(ray_vector, seg_normal);
+    return ray_to_norm != 0 &&
+           DotSign(start_to_seg, seg_normal) * ray_to_norm >= 0;
+  }
+
+  void CrossSegments(const Coord* ax, const Coord* ay, const Coord* bx,
+                     const Coord* by, size_t count, uint8_t* out) const;
+
+  // The quadrant (or half-slab, for an axis-parallel ray) the ray points
+  // into. A degenerate ray contains every point and covers the plane.
+  constexpr BoundingBox GetBoundingBox() const override {
+    BoundingBox box;
+    Vector direct = GetVector();
+    if (direct.GetX() == 0 && direct.GetY() == 0) {
+      return box;
+    }
+    if (direct.GetX() >= 0) {
+      box.min_x = first_.GetX();
+    }
+    if (direct.GetX() <= 0) {
+      box.max_x = first_.GetX();
+    }
+    if (direct.GetY() >= 0) {
+      box.min_y = first_.GetY();
+    }
+    if (direct.GetY() <= 0) {
+      box.max_y = first_.GetY();
+    }
+    return box;
   }
 
   IShape* Clone() const override {
-    Ray* clone = new Ray(first_, second_);
+    BasicRay* clone = new BasicRay(first_, second_);
     return clone;
   }
 
-  ~Ray() {}
+  IShape* CloneInto(ShapeArena& arena) const override {
+    return arena.Create<BasicRay>(first_, second_);
+  }
+
+  constexpr ~BasicRay() {}
 };
 
-class Circle : public IShape {
+template <typename Coord>
+class BasicCircle : public BasicShape<Coord> {
  private:
+  using Vector = BasicVector<Coord>;
+  using Point = BasicPoint<Coord>;
+  using Segment = BasicSegment<Coord>;
+  using BoundingBox = BasicBoundingBox<Coord>;
+  using IShape = BasicShape<Coord>;
+  using Radius = typename CoordTraits<Coord>::Radius;
+  using Square = typename CoordTraits<Coord>::Square;
+
   Point centre_;
-  size_t radius_;
+  Radius radius_;
 
  public:
-  Circle(Point centre, size_t radius) : centre_(centre), radius_(radius) {}
+  constexpr BasicCircle(Point centre, Radius radius)
+      : centre_(centre), radius_(radius) {}
+
+  constexpr ShapeKind GetKind() const override { return ShapeKind::kCircle; }
+
+  constexpr Point GetCentre() const { return centre_; }
+
+  constexpr Radius GetRadius() const { return radius_; }
 
-  Point GetCentre() const { return centre_; }
+  constexpr void Move(const Vector& vector) override { centre_ += vector; }
 
-  size_t GetRadius() const { return radius_; }
+  constexpr bool ContainsPoint(const Point& point) const override {
+    if (CoordTraits<Coord>::kExact &&
+        !GetBoundingBox().Contains(point.GetX(), point.GetY())) {
+      return false;
+    }
+    return CompareValues<Coord>(SquaredLength(Vector(point - centre_)),
+                                RadiusSquared()) <= 0;
+  }
 
-  void Move(const Vector& vector) override { centre_ += vector; }
+  void ContainsPoints(const Coord* xs, const Coord* ys, size_t count,
+                      uint8_t* out) const;
 
-  bool ContainsPoint(const Point& point) const override {
-    Point diff = point - centre_;
-    int64_t expression =
-        (diff.GetX() * diff.GetX()) + (diff.GetY() * diff.GetY());
-    return (expression <= static_cast<int64_t>(radius_ * radius_));
+  constexpr bool PointInCircle(const Point& point) const {
+    return CompareValues<Coord>(SquaredLength(Vector(point - centre_)),
+                                RadiusSquared()) < 0;
   }
 
-  bool PointInCircle(const Point& point) const {
-    Point diff = point - centre_;
-    int64_t expression =
-        (diff.GetX() * diff.GetX()) + (diff.GetY() * diff.GetY());
-    return (expression < static_cast<int64_t>(radius_ * radius_));
+  constexpr Square RadiusSquared() const {
+    return static_cast<Square>(radius_) * radius_;
   }
 
-  bool CrossSegment(const Segment& segment) const override {
+  constexpr BoundingBox GetBoundingBox() const override {
+    Coord radius = radius_ > static_cast<Radius>(BoundingBox::kMax)
+                       ? BoundingBox::kMax
+                       : static_cast<Coord>(radius_);
+    return BoundingBox{SaturatingSub(centre_.GetX(), radius),
+                       SaturatingSub(centre_.GetY(), radius),
+                       SaturatingAdd(centre_.GetX(), radius),
+                       SaturatingAdd(centre_.GetY(), radius)};
+  }
+
+  constexpr bool CrossSegment(const Segment& segment) const override {
+    if (CoordTraits<Coord>::kExact &&
+        !GetBoundingBox().Overlaps(segment.GetBoundingBox())) {
+      return false;
+    }
     Point a_p = segment.GetA();
     Point b_p = segment.GetB();
     if (this->PointInCircle(a_p) && this->PointInCircle(b_p)) {
@@ -326,22 +845,115 @@ class Circle : public IShape {
     Vector ab_vect((b_p - a_p).GetX(), (b_p - a_p).GetY());
     Vector ac_vect((centre_ - a_p).GetX(), (centre_ - a_p).GetY());
     Vector bc_vect((centre_ - b_p).GetX(), (centre_ - b_p).GetY());
-    int64_t ab_len =
-        ab_vect.GetX() * ab_vect.GetX() + ab_vect.GetY() * ab_vect.GetY();
-    if ((ac_vect ^ bc_vect) * (ac_vect ^ bc_vect) >
-        static_cast<int64_t>(radius_ * radius_) * ab_len) {
+    // Farther from the line than the radius: dist^2 * |ab|^2 > r^2 * |ab|^2.
+    Square area_abs = AbsWide<Coord>(WideCross(ac_vect, bc_vect));
+    if (CompareSquareProducts<Coord>(area_abs, area_abs, RadiusSquared(),
+                                     SquaredLength(ab_vect)) > 0) {
       return false;
     }
-    if (this->ContainsPoint(a_p) ^ this->ContainsPoint(b_p)) {
+    // Not both strictly inside, so a contained end is on the circle or the
+    // segment leaves the disc through it. This covers a zero-length segment
+    // on the circle.
+    if (this->ContainsPoint(a_p) || this->ContainsPoint(b_p)) {
       return true;
     }
     Vector ba_vect = -ab_vect;
-    return ((ba_vect * bc_vect) > 0 && (ab_vect * ac_vect) > 0);
+    return DotSign(ba_vect, bc_vect) > 0 && DotSign(ab_vect, ac_vect) > 0;
   }
 
   IShape* Clone() const override {
-    Circle* clone = new Circle(centre_, radius_);
+    BasicCircle* clone = new BasicCircle(centre_, radius_);
     return clone;
   }
+
+  IShape* CloneInto(ShapeArena& arena) const override {
+    return arena.Create<BasicCircle>(centre_, radius_);
+  }
+
+  constexpr ~BasicCircle() {}
 };
 
+// Scalar batch forms. The int64_t instantiations are specialized below and
+// defined with AVX2 kernels in geometry_batch.cpp.
+template <typename Coord>
+void BasicSegment<Coord>::ContainsPoints(const Coord* xs, const Coord* ys,
+                                         size_t count, uint8_t* out) const {
+  for (size_t i = 0; i < count; ++i) {
+    out[i] = BasicSegment::ContainsPoint(Point(xs[i], ys[i]));
+  }
+}
+
+template <typename Coord>
+void BasicSegment<Coord>::CrossSegments(const Coord* ax, const Coord* ay,
+                                        const Coord* bx, const Coord* by,
+                                        size_t count, uint8_t* out) const {
+  for (size_t i = 0; i < count; ++i) {
+    out[i] = BasicSegment::CrossSegment(
+        BasicSegment(Point(ax[i], ay[i]), Point(bx[i], by[i])));
+  }
+}
+
+template <typename Coord>
+void BasicLine<Coord>::CrossSegments(const Coord* ax, const Coord* ay,
+                                     const Coord* bx, const Coord* by,
+                                     size_t count, uint8_t* out) const {
+  for (size_t i = 0; i < count; ++i) {
+    out[i] = BasicLine::CrossSegment(
+        Segment(Point(ax[i], ay[i]), Point(bx[i], by[i])));
+  }
+}
+
+template <typename Coord>
+void BasicRay<Coord>::CrossSegments(const Coord* ax, const Coord* ay,
+                                    const Coord* bx, const Coord* by,
+                                    size_t count, uint8_t* out) const {
+  for (size_t i = 0; i < count; ++i) {
+    out[i] = BasicRay::CrossSegment(
+        Segment(Point(ax[i], ay[i]), Point(bx[i], by[i])));
+  }
+}
+
+template <typename Coord>
+void BasicCircle<Coord>::ContainsPoints(const Coord* xs, const Coord* ys,
+                                        size_t count, uint8_t* out) const {
+  for (size_t i = 0; i < count; ++i) {
+    out[i] = BasicCircle::ContainsPoint(Point(xs[i], ys[i]));
+  }
+}
+
+template <>
+void BasicSegment<int64_t>::ContainsPoints(const int64_t* xs,
+                                           const int64_t* ys, size_t count,
+                                           uint8_t* out) const;
+
+template <>
+void BasicSegment<int64_t>::CrossSegments(const int64_t* ax,
+                                          const int64_t* ay,
+                                          const int64_t* bx,
+                                          const int64_t* by, size_t count,
+                                          uint8_t* out) const;
+
+template <>
+void BasicLine<int64_t>::CrossSegments(const int64_t* ax, const int64_t* ay,
+                                       const int64_t* bx, const int64_t* by,
+                                       size_t count, uint8_t* out) const;
+
+template <>
+void BasicRay<int64_t>::CrossSegments(const int64_t* ax, const int64_t* ay,
+                                      const int64_t* bx, const int64_t* by,
+                                      size_t count, uint8_t* out) const;
+
+template <>
+void BasicCircle<int64_t>::ContainsPoints(const int64_t* xs,
+                                          const int64_t* ys, size_t count,
+                                          uint8_t* out) const;
+
+// The int64_t instantiation is the default geometry.
+using Vector = BasicVector<int64_t>;
+using BoundingBox = BasicBoundingBox<int64_t>;
+using IShape = BasicShape<int64_t>;
+using Point = BasicPoint<int64_t>;
+using Segment = BasicSegment<int64_t>;
+using Line = BasicLine<int64_t>;
+using Ray = BasicRay<int64_t>;
+using Circle = BasicCircle<int64_t>;
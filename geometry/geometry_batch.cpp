@@ -0,0 +1,392 @@
+#include "geometry.hpp"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define GEOMETRY_AVX2_KERNELS 1
+#endif
+
+// Batch predicates. The AVX2 kernels decide lanes whose vectors have
+// components below 2^31 in magnitude, where 32x32-bit products are exact;
+// other lanes, parallel segment pairs and the tail of every batch are
+// marked kUndecided and finished by the scalar predicate. Results match the
+// scalar predicates exactly.
+
+namespace {
+
+const uint8_t kUndecided = 0xFF;
+
+#ifdef GEOMETRY_AVX2_KERNELS
+
+bool HasAvx2() {
+  static const bool kHasAvx2 = __builtin_cpu_supports("avx2");
+  return kHasAvx2;
+}
+
+__attribute__((target("avx2"))) inline __m256i Load(const int64_t* ptr) {
+  return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptr));
+}
+
+__attribute__((target("avx2"))) inline __m256i Not(__m256i mask) {
+  return _mm256_xor_si256(mask, _mm256_set1_epi64x(-1));
+}
+
+// Lanes with -2^31 < value < 2^31, matching FitsHalfWord.
+__attribute__((target("avx2"))) inline __m256i Small(__m256i value) {
+  return _mm256_and_si256(
+      _mm256_cmpgt_epi64(value, _mm256_set1_epi64x(-(int64_t(1) << 31))),
+      _mm256_cmpgt_epi64(_mm256_set1_epi64x(int64_t(1) << 31), value));
+}
+
+__attribute__((target("avx2"))) inline __m256i Small(__m256i xs,
+                                                     __m256i ys) {
+  return _mm256_and_si256(Small(xs), Small(ys));
+}
+
+// Exact for small lanes: mul_epi32 takes the signed low halves.
+__attribute__((target("avx2"))) inline __m256i Cross(__m256i left_x,
+                                                     __m256i left_y,
+                                                     __m256i right_x,
+                                                     __m256i right_y) {
+  return _mm256_sub_epi64(_mm256_mul_epi32(left_x, right_y),
+                          _mm256_mul_epi32(left_y, right_x));
+}
+
+__attribute__((target("avx2"))) inline __m256i Dot(__m256i left_x,
+                                                   __m256i left_y,
+                                                   __m256i right_x,
+                                                   __m256i right_y) {
+  return _mm256_add_epi64(_mm256_mul_epi32(left_x, right_x),
+                          _mm256_mul_epi32(left_y, right_y));
+}
+
+// Lanes where left * right <= 0, by signs alone.
+__attribute__((target("avx2"))) inline __m256i OppositeOrZero(__m256i left,
+                                                              __m256i right) {
+  __m256i zero = _mm256_setzero_si256();
+  __m256i both_positive = _mm256_and_si256(_mm256_cmpgt_epi64(left, zero),
+                                           _mm256_cmpgt_epi64(right, zero));
+  __m256i both_negative = _mm256_and_si256(_mm256_cmpgt_epi64(zero, left),
+                                           _mm256_cmpgt_epi64(zero, right));
+  return Not(_mm256_or_si256(both_positive, both_negative));
+}
+
+// Lanes where left * right >= 0.
+__attribute__((target("avx2"))) inline __m256i SameOrZero(__m256i left,
+                                                          __m256i right) {
+  return OppositeOrZero(_mm256_sub_epi64(_mm256_setzero_si256(), left),
+                        right);
+}
+
+// Lanes whose segment has a bounding box disjoint from 'box': both ends
+// lie beyond the same side.
+__attribute__((target("avx2"))) inline __m256i DisjointFromBox(
+    __m256i begin_x, __m256i begin_y, __m256i end_x, __m256i end_y,
+    const BoundingBox& box) {
+  __m256i min_x = _mm256_set1_epi64x(box.min_x);
+  __m256i min_y = _mm256_set1_epi64x(box.min_y);
+  __m256i max_x = _mm256_set1_epi64x(box.max_x);
+  __m256i max_y = _mm256_set1_epi64x(box.max_y);
+  __m256i left = _mm256_and_si256(_mm256_cmpgt_epi64(min_x, begin_x),
+                                  _mm256_cmpgt_epi64(min_x, end_x));
+  __m256i right = _mm256_and_si256(_mm256_cmpgt_epi64(begin_x, max_x),
+                                   _mm256_cmpgt_epi64(end_x, max_x));
+  __m256i below = _mm256_and_si256(_mm256_cmpgt_epi64(min_y, begin_y),
+                                   _mm256_cmpgt_epi64(min_y, end_y));
+  __m256i above = _mm256_and_si256(_mm256_cmpgt_epi64(begin_y, max_y),
+                                   _mm256_cmpgt_epi64(end_y, max_y));
+  return _mm256_or_si256(_mm256_or_si256(left, right),
+                         _mm256_or_si256(below, above));
+}
+
+__attribute__((target("avx2"))) inline void Store(__m256i result,
+                                                  __m256i undecided,
+                                                  uint8_t* out) {
+  int bits = _mm256_movemask_pd(_mm256_castsi256_pd(result));
+  int skip = _mm256_movemask_pd(_mm256_castsi256_pd(undecided));
+  for (int lane = 0; lane < 4; ++lane) {
+    out[lane] = ((skip >> lane) & 1) ? kUndecided : ((bits >> lane) & 1);
+  }
+}
+
+// Requires radius < 2^31: a lane with a component of at least 2^31 is then
+// outside, so every lane is decided.
+__attribute__((target("avx2"))) size_t CircleContainsAvx2(
+    int64_t centre_x, int64_t centre_y, int64_t radius_sq, const int64_t* xs,
+    const int64_t* ys, size_t count, uint8_t* out) {
+  __m256i cx = _mm256_set1_epi64x(centre_x);
+  __m256i cy = _mm256_set1_epi64x(centre_y);
+  __m256i rr = _mm256_set1_epi64x(radius_sq);
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m256i dx = _mm256_sub_epi64(Load(xs + i), cx);
+    __m256i dy = _mm256_sub_epi64(Load(ys + i), cy);
+    __m256i dist = Dot(dx, dy, dx, dy);
+    __m256i inside =
+        _mm256_andnot_si256(_mm256_cmpgt_epi64(dist, rr), Small(dx, dy));
+    Store(inside, _mm256_setzero_si256(), out + i);
+  }
+  return i;
+}
+
+// Requires a small, non-degenerate segment.
+__attribute__((target("avx2"))) size_t SegmentContainsAvx2(
+    int64_t begin_x, int64_t begin_y, int64_t end_x, int64_t end_y,
+    const int64_t* xs, const int64_t* ys, size_t count, uint8_t* out) {
+  __m256i bx = _mm256_set1_epi64x(begin_x);
+  __m256i by = _mm256_set1_epi64x(begin_y);
+  __m256i ex = _mm256_set1_epi64x(end_x);
+  __m256i ey = _mm256_set1_epi64x(end_y);
+  __m256i abx = _mm256_sub_epi64(ex, bx);
+  __m256i aby = _mm256_sub_epi64(ey, by);
+  __m256i zero = _mm256_setzero_si256();
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m256i px = Load(xs + i);
+    __m256i py = Load(ys + i);
+    __m256i acx = _mm256_sub_epi64(px, bx);
+    __m256i acy = _mm256_sub_epi64(py, by);
+    __m256i bcx = _mm256_sub_epi64(px, ex);
+    __m256i bcy = _mm256_sub_epi64(py, ey);
+    __m256i on_line = _mm256_cmpeq_epi64(Cross(acx, acy, abx, aby), zero);
+    // bc * ba >= 0 is bc * ab <= 0.
+    __m256i after_begin =
+        Not(_mm256_cmpgt_epi64(zero, Dot(acx, acy, abx, aby)));
+    __m256i before_end =
+        Not(_mm256_cmpgt_epi64(Dot(bcx, bcy, abx, aby), zero));
+    __m256i result =
+        _mm256_and_si256(on_line, _mm256_and_si256(after_begin, before_end));
+    __m256i small = _mm256_and_si256(Small(acx, acy), Small(bcx, bcy));
+    Store(result, Not(small), out + i);
+  }
+  return i;
+}
+
+// Requires a small direction.
+__attribute__((target("avx2"))) size_t LineCrossAvx2(
+    int64_t first_x, int64_t first_y, int64_t second_x, int64_t second_y,
+    const int64_t* ax, const int64_t* ay, const int64_t* bx,
+    const int64_t* by, size_t count, uint8_t* out) {
+  __m256i fx = _mm256_set1_epi64x(first_x);
+  __m256i fy = _mm256_set1_epi64x(first_y);
+  __m256i abx = _mm256_set1_epi64x(second_x - first_x);
+  __m256i aby = _mm256_set1_epi64x(second_y - first_y);
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m256i acx = _mm256_sub_epi64(Load(ax + i), fx);
+    __m256i acy = _mm256_sub_epi64(Load(ay + i), fy);
+    __m256i adx = _mm256_sub_epi64(Load(bx + i), fx);
+    __m256i ady = _mm256_sub_epi64(Load(by + i), fy);
+    __m256i result = OppositeOrZero(Cross(abx, aby, acx, acy),
+                                    Cross(abx, aby, adx, ady));
+    __m256i small = _mm256_and_si256(Small(acx, acy), Small(adx, ady));
+    Store(result, Not(small), out + i);
+  }
+  return i;
+}
+
+// Requires a small direction.
+__attribute__((target("avx2"))) size_t SegmentCrossAvx2(
+    int64_t begin_x, int64_t begin_y, int64_t end_x, int64_t end_y,
+    const BoundingBox& box, const int64_t* ax, const int64_t* ay,
+    const int64_t* bx, const int64_t* by, size_t count, uint8_t* out) {
+  __m256i pax = _mm256_set1_epi64x(begin_x);
+  __m256i pay = _mm256_set1_epi64x(begin_y);
+  __m256i pbx = _mm256_set1_epi64x(end_x);
+  __m256i pby = _mm256_set1_epi64x(end_y);
+  __m256i abx = _mm256_sub_epi64(pbx, pax);
+  __m256i aby = _mm256_sub_epi64(pby, pay);
+  __m256i zero = _mm256_setzero_si256();
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m256i cx = Load(ax + i);
+    __m256i cy = Load(ay + i);
+    __m256i dx = Load(bx + i);
+    __m256i dy = Load(by + i);
+    __m256i cdx = _mm256_sub_epi64(dx, cx);
+    __m256i cdy = _mm256_sub_epi64(dy, cy);
+    __m256i acx = _mm256_sub_epi64(cx, pax);
+    __m256i acy = _mm256_sub_epi64(cy, pay);
+    __m256i adx = _mm256_sub_epi64(dx, pax);
+    __m256i ady = _mm256_sub_epi64(dy, pay);
+    __m256i cbx = _mm256_sub_epi64(pbx, cx);
+    __m256i cby = _mm256_sub_epi64(pby, cy);
+    __m256i cax = _mm256_sub_epi64(zero, acx);
+    __m256i cay = _mm256_sub_epi64(zero, acy);
+    __m256i small = _mm256_and_si256(
+        _mm256_and_si256(Small(cdx, cdy), Small(acx, acy)),
+        _mm256_and_si256(Small(adx, ady), Small(cbx, cby)));
+    // Parallel and collinear pairs go through the scalar endpoint tests.
+    __m256i parallel = _mm256_cmpeq_epi64(Cross(abx, aby, cdx, cdy), zero);
+    __m256i result = _mm256_and_si256(
+        OppositeOrZero(Cross(abx, aby, acx, acy), Cross(abx, aby, adx, ady)),
+        OppositeOrZero(Cross(cdx, cdy, cax, cay),
+                       Cross(cdx, cdy, cbx, cby)));
+    __m256i disjoint = DisjointFromBox(cx, cy, dx, dy, box);
+    __m256i undecided = _mm256_or_si256(Not(small), parallel);
+    Store(_mm256_andnot_si256(disjoint, result),
+          _mm256_andnot_si256(disjoint, undecided), out + i);
+  }
+  return i;
+}
+
+// Requires a small, non-zero direction.
+__attribute__((target("avx2"))) size_t RayCrossAvx2(
+    int64_t first_x, int64_t first_y, int64_t direct_x, int64_t direct_y,
+    const int64_t* ax, const int64_t* ay, const int64_t* bx,
+    const int64_t* by, size_t count, uint8_t* out) {
+  __m256i fx = _mm256_set1_epi64x(first_x);
+  __m256i fy = _mm256_set1_epi64x(first_y);
+  __m256i rx = _mm256_set1_epi64x(direct_x);
+  __m256i ry = _mm256_set1_epi64x(direct_y);
+  __m256i zero = _mm256_setzero_si256();
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m256i cx = Load(ax + i);
+    __m256i cy = Load(ay + i);
+    __m256i dx = Load(bx + i);
+    __m256i dy = Load(by + i);
+    __m256i acx = _mm256_sub_epi64(cx, fx);
+    __m256i acy = _mm256_sub_epi64(cy, fy);
+    __m256i adx = _mm256_sub_epi64(dx, fx);
+    __m256i ady = _mm256_sub_epi64(dy, fy);
+    __m256i cdx = _mm256_sub_epi64(dx, cx);
+    __m256i cdy = _mm256_sub_epi64(dy, cy);
+    __m256i small = _mm256_and_si256(
+        Small(cdx, cdy), _mm256_and_si256(Small(acx, acy), Small(adx, ady)));
+    // An endpoint on the ray: on its line and not behind the start.
+    __m256i side_c = Cross(rx, ry, acx, acy);
+    __m256i side_d = Cross(rx, ry, adx, ady);
+    __m256i holds_c =
+        _mm256_andnot_si256(_mm256_cmpgt_epi64(zero, Dot(acx, acy, rx, ry)),
+                            _mm256_cmpeq_epi64(side_c, zero));
+    __m256i holds_d =
+        _mm256_andnot_si256(_mm256_cmpgt_epi64(zero, Dot(adx, ady, rx, ry)),
+                            _mm256_cmpeq_epi64(side_d, zero));
+    // Otherwise the segment must cross the line ahead of the start: the
+    // crossing parameter (ac ^ cd) / (r ^ cd) is non-negative.
+    __m256i divisor = Cross(rx, ry, cdx, cdy);
+    __m256i ahead =
+        _mm256_andnot_si256(_mm256_cmpeq_epi64(divisor, zero),
+                            SameOrZero(Cross(acx, acy, cdx, cdy), divisor));
+    __m256i crossing =
+        _mm256_and_si256(OppositeOrZero(side_c, side_d), ahead);
+    __m256i result =
+        _mm256_or_si256(_mm256_or_si256(holds_c, holds_d), crossing);
+    Store(result, Not(small), out + i);
+  }
+  return i;
+}
+
+#endif
+
+}  // namespace
+
+template <>
+void Circle::ContainsPoints(const int64_t* xs, const int64_t* ys,
+                            size_t count, uint8_t* out) const {
+  size_t done = 0;
+#ifdef GEOMETRY_AVX2_KERNELS
+  if (HasAvx2() && radius_ < (size_t(1) << 31)) {
+    done = CircleContainsAvx2(centre_.GetX(), centre_.GetY(),
+                              static_cast<int64_t>(radius_ * radius_), xs, ys,
+                              count, out);
+  }
+#endif
+  for (; done < count; ++done) {
+    out[done] = Circle::ContainsPoint(Point(xs[done], ys[done]));
+  }
+}
+
+template <>
+void Segment::ContainsPoints(const int64_t* xs, const int64_t* ys,
+                             size_t count, uint8_t* out) const {
+  size_t done = 0;
+#ifdef GEOMETRY_AVX2_KERNELS
+  Vector ab_vect((end_ - begin_).GetX(), (end_ - begin_).GetY());
+  // A degenerate segment is a point test, left to the scalar path.
+  if (HasAvx2() && FitsHalfWord(ab_vect) && !(ab_vect == -ab_vect)) {
+    done = SegmentContainsAvx2(begin_.GetX(), begin_.GetY(), end_.GetX(),
+                               end_.GetY(), xs, ys, count, out);
+    for (size_t i = 0; i < done; ++i) {
+      if (out[i] == kUndecided) {
+        out[i] = Segment::ContainsPoint(Point(xs[i], ys[i]));
+      }
+    }
+  }
+#endif
+  for (; done < count; ++done) {
+    out[done] = Segment::ContainsPoint(Point(xs[done], ys[done]));
+  }
+}
+
+template <>
+void Segment::CrossSegments(const int64_t* ax, const int64_t* ay,
+                            const int64_t* bx, const int64_t* by,
+                            size_t count, uint8_t* out) const {
+  size_t done = 0;
+#ifdef GEOMETRY_AVX2_KERNELS
+  if (HasAvx2() && FitsHalfWord(Vector(end_ - begin_))) {
+    done = SegmentCrossAvx2(begin_.GetX(), begin_.GetY(), end_.GetX(),
+                            end_.GetY(), GetBoundingBox(), ax, ay, bx, by,
+                            count, out);
+    for (size_t i = 0; i < done; ++i) {
+      if (out[i] == kUndecided) {
+        out[i] = Segment::CrossSegment(
+            Segment(Point(ax[i], ay[i]), Point(bx[i], by[i])));
+      }
+    }
+  }
+#endif
+  for (; done < count; ++done) {
+    out[done] = Segment::CrossSegment(
+        Segment(Point(ax[done], ay[done]), Point(bx[done], by[done])));
+  }
+}
+
+template <>
+void Line::CrossSegments(const int64_t* ax, const int64_t* ay,
+                         const int64_t* bx, const int64_t* by, size_t count,
+                         uint8_t* out) const {
+  size_t done = 0;
+#ifdef GEOMETRY_AVX2_KERNELS
+  if (HasAvx2() && FitsHalfWord(Vector(second_ - first_))) {
+    done = LineCrossAvx2(first_.GetX(), first_.GetY(), second_.GetX(),
+                         second_.GetY(), ax, ay, bx, by, count, out);
+    for (size_t i = 0; i < done; ++i) {
+      if (out[i] == kUndecided) {
+        out[i] = Line::CrossSegment(
+            Segment(Point(ax[i], ay[i]), Point(bx[i], by[i])));
+      }
+    }
+  }
+#endif
+  for (; done < count; ++done) {
+    out[done] = Line::CrossSegment(
+        Segment(Point(ax[done], ay[done]), Point(bx[done], by[done])));
+  }
+}
+
+template <>
+void Ray::CrossSegments(const int64_t* ax, const int64_t* ay,
+                        const int64_t* bx, const int64_t* by, size_t count,
+                        uint8_t* out) const {
+  size_t done = 0;
+#ifdef GEOMETRY_AVX2_KERNELS
+  Vector direct = GetVector();
+  // A degenerate ray contains every point, left to the scalar path.
+  if (HasAvx2() && FitsHalfWord(direct) && !(direct == -direct)) {
+    done = RayCrossAvx2(first_.GetX(), first_.GetY(), direct.GetX(),
+                        direct.GetY(), ax, ay, bx, by, count, out);
+    for (size_t i = 0; i < done; ++i) {
+      if (out[i] == kUndecided) {
+        out[i] = Ray::CrossSegment(
+            Segment(Point(ax[i], ay[i]), Point(bx[i], by[i])));
+      }
+    }
+  }
+#endif
+  for (; done < count; ++done) {
+    out[done] = Ray::CrossSegment(
+        Segment(Point(ax[done], ay[done]), Point(bx[done], by[done])));
+  }
+}
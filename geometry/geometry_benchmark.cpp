@@ -0,0 +1,309 @@
+// Benchmarks the geometry predicates: ns per call of each shape's
+// ContainsPoint and CrossSegment, their prepared forms, the batch kernels
+// and Intersects, over several input distributions.
+//
+//   g++ -std=c++20 -O2 geometry/geometry_benchmark.cpp
+//       geometry/geometry_batch.cpp geometry/intersection.cpp
+//       geometry/polygon.cpp -o geometry_benchmark
+//   ./geometry_benchmark [count]
+//
+// Each case tests 'count' shapes (default 4096) against one query each,
+// repeated until it has run about 10^7 calls. The distributions:
+//   random     uniform coordinates below 2^30, where the fast paths apply;
+//   wide       uniform coordinates below 2^61, in 128-bit arithmetic;
+//   clustered  shapes and queries within 64 units of 16 centres, so box
+//              rejects rarely apply;
+//   collinear  every point on one line;
+//   touching   queries starting on the shape's endpoint or circle;
+//   zero       zero-length segments and rays, zero radii.
+// Every line also gives the share of calls that returned true.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "geometry.hpp"
+#include "intersection.hpp"
+#include "prepared.hpp"
+
+namespace {
+
+template <typename T>
+void DoNotOptimize(const T& value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// One shape's defining points and its queries: 'a' and 'b' give the
+// segment, line and ray, 'a' and 'radius' the circle, 'p' the point query
+// and 'c' to 'd' the segment query.
+struct Case {
+  Point a{0, 0};
+  Point b{0, 0};
+  size_t radius = 0;
+  Point p{0, 0};
+  Point c{0, 0};
+  Point d{0, 0};
+};
+
+const size_t kTargetCalls = 10000000;
+
+class Generator {
+ public:
+  explicit Generator(uint64_t seed) : rng_(seed) {}
+
+  int64_t Uniform(int64_t bound) {
+    return static_cast<int64_t>(rng_() % (2 * static_cast<uint64_t>(bound) +
+                                          1)) -
+           bound;
+  }
+
+  Point UniformPoint(int64_t bound) {
+    return Point(Uniform(bound), Uniform(bound));
+  }
+
+  std::vector<Case> Random(size_t count, int64_t bound) {
+    std::vector<Case> cases(count);
+    for (Case& item : cases) {
+      item.a = UniformPoint(bound);
+      item.b = UniformPoint(bound);
+      item.radius = static_cast<size_t>(Uniform(bound / 2) + bound / 2);
+      item.p = UniformPoint(bound);
+      item.c = UniformPoint(bound);
+      item.d = UniformPoint(bound);
+    }
+    return cases;
+  }
+
+  std::vector<Case> Clustered(size_t count) {
+    std::vector<Point> centres;
+    for (int i = 0; i < 16; ++i) {
+      centres.push_back(UniformPoint(1 << 30));
+    }
+    std::vector<Case> cases(count);
+    for (Case& item : cases) {
+      Point centre = centres[rng_() % centres.size()];
+      auto near = [&] {
+        return Point(Vector(centre) + Vector(Uniform(64), Uniform(64)));
+      };
+      item.a = near();
+      item.b = near();
+      item.radius = static_cast<size_t>(Uniform(32) + 32);
+      item.p = near();
+      item.c = near();
+      item.d = near();
+    }
+    return cases;
+  }
+
+  std::vector<Case> Collinear(size_t count) {
+    auto on_line = [this] {
+      int64_t x = Uniform(1 << 20);
+      return Point(x, 3 * x + 7);
+    };
+    std::vector<Case> cases(count);
+    for (Case& item : cases) {
+      item.a = on_line();
+      item.b = on_line();
+      item.radius = static_cast<size_t>(Uniform(1 << 19) + (1 << 19));
+      item.p = on_line();
+      item.c = on_line();
+      item.d = on_line();
+    }
+    return cases;
+  }
+
+  std::vector<Case> Touching(size_t count) {
+    std::vector<Case> cases = Random(count, 1 << 30);
+    for (size_t i = 0; i < count; ++i) {
+      Case& item = cases[i];
+      item.radius /= 2;
+      Point on_circle(item.a.GetX() + static_cast<int64_t>(item.radius),
+                      item.a.GetY());
+      item.p = i % 2 == 0 ? item.b : on_circle;
+      item.c = item.p;
+    }
+    return cases;
+  }
+
+  std::vector<Case> Zero(size_t count) {
+    std::vector<Case> cases = Random(count, 1 << 30);
+    for (size_t i = 0; i < count; ++i) {
+      Case& item = cases[i];
+      item.b = item.a;
+      item.radius = 0;
+      item.d = item.c;
+      if (i % 2 == 0) {
+        item.p = item.a;
+        item.c = item.d = item.a;
+      }
+    }
+    return cases;
+  }
+
+ private:
+  std::mt19937_64 rng_;
+};
+
+// Calls test(i) for every case until about kTargetCalls calls are made,
+// and prints ns per call and the share of true results.
+template <typename Test>
+void Measure(const char* distribution, const char* shape,
+             const char* predicate, size_t count, Test test) {
+  size_t repeats = std::max<size_t>(1, kTargetCalls / count);
+  size_t hits = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t repeat = 0; repeat < repeats; ++repeat) {
+    for (size_t i = 0; i < count; ++i) {
+      hits += test(i);
+    }
+    DoNotOptimize(hits);
+  }
+  auto finish = std::chrono::steady_clock::now();
+  double calls = static_cast<double>(repeats * count);
+  double ns = std::chrono::duration<double, std::nano>(finish - start).count();
+  std::printf("%-10s %-16s %-14s %8.2f ns/op %6.1f%% true\n", distribution,
+              shape, predicate, ns / calls, 100.0 * hits / calls);
+}
+
+// The batch kernels test one shape against many queries: batch(i, out)
+// runs shape i over all 'count' queries of the distribution.
+template <typename Batch>
+void MeasureBatch(const char* distribution, const char* shape,
+                  const char* predicate, size_t count, Batch batch) {
+  std::vector<uint8_t> out(count);
+  size_t calls = std::max<size_t>(1, kTargetCalls / count);
+  auto start = std::chrono::steady_clock::now();
+  for (size_t call = 0; call < calls; ++call) {
+    batch(call % count, out.data());
+    DoNotOptimize(out[0]);
+  }
+  auto finish = std::chrono::steady_clock::now();
+  double ns = std::chrono::duration<double, std::nano>(finish - start).count();
+  size_t hits = 0;
+  for (size_t i = 0; i < std::min(calls, count); ++i) {
+    batch(i, out.data());
+    for (uint8_t hit : out) {
+      hits += hit;
+    }
+  }
+  double tested = static_cast<double>(std::min(calls, count) * count);
+  std::printf("%-10s %-16s %-14s %8.2f ns/op %6.1f%% true\n", distribution,
+              shape, predicate, ns / (calls * count), 100.0 * hits / tested);
+}
+
+void RunDistribution(const char* name, const std::vector<Case>& cases) {
+  size_t count = cases.size();
+  std::vector<Point> points;
+  std::vector<Segment> segments, queries;
+  std::vector<Line> lines;
+  std::vector<Ray> rays;
+  std::vector<Circle> circles;
+  std::vector<int64_t> xs, ys, ax, ay, bx, by;
+  for (const Case& item : cases) {
+    points.push_back(item.a);
+    segments.emplace_back(item.a, item.b);
+    lines.emplace_back(item.a, item.b);
+    rays.emplace_back(item.a, item.b);
+    circles.emplace_back(item.a, item.radius);
+    queries.emplace_back(item.c, item.d);
+    xs.push_back(item.p.GetX());
+    ys.push_back(item.p.GetY());
+    ax.push_back(item.c.GetX());
+    ay.push_back(item.c.GetY());
+    bx.push_back(item.d.GetX());
+    by.push_back(item.d.GetY());
+  }
+  std::vector<PreparedSegment> prepared_segments(segments.begin(),
+                                                 segments.end());
+  std::vector<PreparedLine> prepared_lines(lines.begin(), lines.end());
+  std::vector<PreparedRay> prepared_rays(rays.begin(), rays.end());
+  std::vector<PreparedCircle> prepared_circles(circles.begin(),
+                                               circles.end());
+
+  auto contains = [&](const char* shape, const auto& shapes) {
+    Measure(name, shape, "ContainsPoint", count, [&](size_t i) {
+      return shapes[i].ContainsPoint(cases[i].p);
+    });
+  };
+  auto crosses = [&](const char* shape, const auto& shapes) {
+    Measure(name, shape, "CrossSegment", count, [&](size_t i) {
+      return shapes[i].CrossSegment(queries[i]);
+    });
+  };
+  contains("Point", points);
+  crosses("Point", points);
+  contains("Segment", segments);
+  crosses("Segment", segments);
+  contains("PreparedSegment", prepared_segments);
+  crosses("PreparedSegment", prepared_segments);
+  contains("Line", lines);
+  crosses("Line", lines);
+  contains("PreparedLine", prepared_lines);
+  crosses("PreparedLine", prepared_lines);
+  contains("Ray", rays);
+  crosses("Ray", rays);
+  contains("PreparedRay", prepared_rays);
+  crosses("PreparedRay", prepared_rays);
+  contains("Circle", circles);
+  crosses("Circle", circles);
+  contains("PreparedCircle", prepared_circles);
+  crosses("PreparedCircle", prepared_circles);
+
+  // Through the vtable, as callers holding IShape pointers pay it.
+  std::vector<const IShape*> shapes;
+  for (size_t i = 0; i < count; ++i) {
+    const IShape* kinds[] = {&points[i], &segments[i], &lines[i], &rays[i],
+                             &circles[i]};
+    shapes.push_back(kinds[i % 5]);
+  }
+  Measure(name, "IShape mix", "ContainsPoint", count,
+          [&](size_t i) { return shapes[i]->ContainsPoint(cases[i].p); });
+  Measure(name, "IShape mix", "CrossSegment", count,
+          [&](size_t i) { return shapes[i]->CrossSegment(queries[i]); });
+  Measure(name, "IShape mix", "Intersects", count, [&](size_t i) {
+    return Intersects(*shapes[i], *shapes[(i + 1) % count]);
+  });
+
+  MeasureBatch(name, "Segment", "ContainsPoints", count,
+               [&](size_t i, uint8_t* out) {
+                 segments[i].ContainsPoints(xs.data(), ys.data(), count, out);
+               });
+  MeasureBatch(name, "Circle", "ContainsPoints", count,
+               [&](size_t i, uint8_t* out) {
+                 circles[i].ContainsPoints(xs.data(), ys.data(), count, out);
+               });
+  MeasureBatch(name, "Segment", "CrossSegments", count,
+               [&](size_t i, uint8_t* out) {
+                 segments[i].CrossSegments(ax.data(), ay.data(), bx.data(),
+                                           by.data(), count, out);
+               });
+  MeasureBatch(name, "Line", "CrossSegments", count,
+               [&](size_t i, uint8_t* out) {
+                 lines[i].CrossSegments(ax.data(), ay.data(), bx.data(),
+                                        by.data(), count, out);
+               });
+  MeasureBatch(name, "Ray", "CrossSegments", count,
+               [&](size_t i, uint8_t* out) {
+                 rays[i].CrossSegments(ax.data(), ay.data(), bx.data(),
+                                       by.data(), count, out);
+               });
+  MeasureBatch(name, "IShape mix", "Intersects", count,
+               [&](size_t i, uint8_t* out) {
+                 Intersects(*shapes[i], shapes.data(), count, out);
+               });
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 4096;
+  Generator generator(count);
+  RunDistribution("random", generator.Random(count, 1 << 30));
+  RunDistribution("wide", generator.Random(count, int64_t{1} << 61));
+  RunDistribution("clustered", generator.Clustered(count));
+  RunDistribution("collinear", generator.Collinear(count));
+  RunDistribution("touching", generator.Touching(count));
+  RunDistribution("zero", generator.Zero(count));
+}
@@ -0,0 +1,756 @@
+// Differential fuzzer for the geometry predicates. Every ContainsPoint and
+// CrossSegment, their prepared and batch forms, arena clones and the
+// int32_t instantiation are checked against a reference written separately
+// from the definitions, in arbitrary-precision integers. ShapeGrid queries
+// are checked against a scan of every shape.
+//
+//   g++ -std=c++20 -O2 geometry/geometry_fuzz.cpp geometry/geometry_batch.cpp
+//       geometry/polygon.cpp geometry/spatial_index.cpp -o geometry_fuzz
+//   ./geometry_fuzz [rounds] [seed]
+//
+// Coordinates are drawn at scales from 2 up to the exactness limit, mixed
+// with degenerate inputs: zero-length segments and rays, zero radii,
+// lattice points on a shape's line or circle and one unit off them, and
+// shared endpoints. The first mismatches are printed with their
+// coordinates, and the exit status is 1 if there were any.
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "geometry.hpp"
+#include "polygon.hpp"
+#include "prepared.hpp"
+#include "shape_arena.hpp"
+#include "spatial_index.hpp"
+
+namespace {
+
+// Sign and magnitude, the magnitude in base-2^32 digits, least
+// significant first, without leading zeros.
+class BigInt {
+ public:
+  explicit BigInt(int64_t value = 0) : negative_(value < 0) {
+    uint64_t magnitude = negative_ ? 0 - static_cast<uint64_t>(value)
+                                   : static_cast<uint64_t>(value);
+    for (; magnitude != 0; magnitude >>= 32) {
+      digits_.push_back(static_cast<uint32_t>(magnitude));
+    }
+  }
+
+  int Sign() const {
+    if (digits_.empty()) {
+      return 0;
+    }
+    return negative_ ? -1 : 1;
+  }
+
+  BigInt operator-() const {
+    return BigInt(!negative_, digits_);
+  }
+
+  friend BigInt operator+(const BigInt& left, const BigInt& right) {
+    if (left.negative_ == right.negative_) {
+      return BigInt(left.negative_, Add(left.digits_, right.digits_));
+    }
+    if (Less(left.digits_, right.digits_)) {
+      return BigInt(right.negative_, Subtract(right.digits_, left.digits_));
+    }
+    return BigInt(left.negative_, Subtract(left.digits_, right.digits_));
+  }
+
+  friend BigInt operator-(const BigInt& left, const BigInt& right) {
+    return left + -right;
+  }
+
+  friend BigInt operator*(const BigInt& left, const BigInt& right) {
+    std::vector<uint32_t> product(left.digits_.size() + right.digits_.size());
+    for (size_t i = 0; i < left.digits_.size(); ++i) {
+      uint64_t carry = 0;
+      for (size_t j = 0; j < right.digits_.size(); ++j) {
+        uint64_t sum = static_cast<uint64_t>(left.digits_[i]) *
+                           right.digits_[j] +
+                       product[i + j] + carry;
+        product[i + j] = static_cast<uint32_t>(sum);
+        carry = sum >> 32;
+      }
+      product[i + right.digits_.size()] = static_cast<uint32_t>(carry);
+    }
+    return BigInt(left.negative_ != right.negative_, std::move(product));
+  }
+
+  friend int Compare(const BigInt& left, const BigInt& right) {
+    return (left - right).Sign();
+  }
+
+ private:
+  BigInt(bool negative, std::vector<uint32_t> digits)
+      : digits_(std::move(digits)) {
+    while (!digits_.empty() && digits_.back() == 0) {
+      digits_.pop_back();
+    }
+    negative_ = negative && !digits_.empty();
+  }
+
+  static bool Less(const std::vector<uint32_t>& left,
+                   const std::vector<uint32_t>& right) {
+    if (left.size() != right.size()) {
+      return left.size() < right.size();
+    }
+    return std::lexicographical_compare(left.rbegin(), left.rend(),
+                                        right.rbegin(), right.rend());
+  }
+
+  static std::vector<uint32_t> Add(const std::vector<uint32_t>& left,
+                                   const std::vector<uint32_t>& right) {
+    std::vector<uint32_t> sum(std::max(left.size(), right.size()) + 1);
+    uint64_t carry = 0;
+    for (size_t i = 0; i < sum.size(); ++i) {
+      carry += (i < left.size() ? left[i] : 0);
+      carry += (i < right.size() ? right[i] : 0);
+      sum[i] = static_cast<uint32_t>(carry);
+      carry >>= 32;
+    }
+    return sum;
+  }
+
+  // 'left' must not be less than 'right'.
+  static std::vector<uint32_t> Subtract(const std::vector<uint32_t>& left,
+                                        const std::vector<uint32_t>& right) {
+    std::vector<uint32_t> difference(left.size());
+    int64_t borrow = 0;
+    for (size_t i = 0; i < left.size(); ++i) {
+      int64_t digit = static_cast<int64_t>(left[i]) - borrow -
+                      (i < right.size() ? right[i] : 0);
+      borrow = digit < 0 ? 1 : 0;
+      difference[i] = static_cast<uint32_t>(digit + (borrow << 32));
+    }
+    return difference;
+  }
+
+  bool negative_;
+  std::vector<uint32_t> digits_;
+};
+
+// The reference works on plain coordinates.
+struct Pt {
+  int64_t x;
+  int64_t y;
+
+  bool operator==(const Pt& other) const {
+    return x == other.x && y == other.y;
+  }
+};
+
+struct BigVec {
+  BigInt x;
+  BigInt y;
+};
+
+BigVec Sub(const Pt& to, const Pt& from) {
+  return BigVec{BigInt(to.x) - BigInt(from.x), BigInt(to.y) - BigInt(from.y)};
+}
+
+BigInt Cross(const BigVec& left, const BigVec& right) {
+  return left.x * right.y - left.y * right.x;
+}
+
+BigInt Dot(const BigVec& left, const BigVec& right) {
+  return left.x * right.x + left.y * right.y;
+}
+
+BigInt Norm(const BigVec& vect) { return Dot(vect, vect); }
+
+// Which side of the line from 'a' through 'b' the point 'p' is on.
+int Orientation(const Pt& a, const Pt& b, const Pt& p) {
+  return Cross(Sub(b, a), Sub(p, a)).Sign();
+}
+
+bool RefOnSegment(const Pt& a, const Pt& b, const Pt& p) {
+  return Orientation(a, b, p) == 0 && std::min(a.x, b.x) <= p.x &&
+         p.x <= std::max(a.x, b.x) && std::min(a.y, b.y) <= p.y &&
+         p.y <= std::max(a.y, b.y);
+}
+
+bool RefSegmentsMeet(const Pt& a, const Pt& b, const Pt& c, const Pt& d) {
+  if (Orientation(a, b, c) * Orientation(a, b, d) < 0 &&
+      Orientation(c, d, a) * Orientation(c, d, b) < 0) {
+    return true;
+  }
+  return RefOnSegment(a, b, c) || RefOnSegment(a, b, d) ||
+         RefOnSegment(c, d, a) || RefOnSegment(c, d, b);
+}
+
+bool RefLineContains(const Pt& a, const Pt& b, const Pt& p) {
+  return Orientation(a, b, p) == 0;
+}
+
+bool RefLineMeets(const Pt& a, const Pt& b, const Pt& c, const Pt& d) {
+  return Orientation(a, b, c) * Orientation(a, b, d) <= 0;
+}
+
+// The ray from 'o' through 'e'; o == e gives a ray containing everything.
+bool RefRayContains(const Pt& o, const Pt& e, const Pt& p) {
+  return Orientation(o, e, p) == 0 && Dot(Sub(e, o), Sub(p, o)).Sign() >= 0;
+}
+
+// Solves o + t (e - o) = c + u (d - c) for t >= 0 and 0 <= u <= 1.
+bool RefRayMeets(const Pt& o, const Pt& e, const Pt& c, const Pt& d) {
+  if (RefRayContains(o, e, c) || RefRayContains(o, e, d)) {
+    return true;
+  }
+  BigVec direct = Sub(e, o);
+  BigVec along = Sub(d, c);
+  BigVec start = Sub(c, o);
+  BigInt det = Cross(direct, along);
+  if (det.Sign() == 0) {
+    // A parallel segment with neither end on the ray misses it.
+    return false;
+  }
+  BigInt t_num = Cross(start, along);
+  BigInt u_num = Cross(start, direct);
+  if (det.Sign() < 0) {
+    det = -det;
+    t_num = -t_num;
+    u_num = -u_num;
+  }
+  return t_num.Sign() >= 0 && u_num.Sign() >= 0 && Compare(u_num, det) <= 0;
+}
+
+bool RefCircleContains(const Pt& centre, int64_t radius, const Pt& p) {
+  return Compare(Norm(Sub(p, centre)), BigInt(radius) * BigInt(radius)) <= 0;
+}
+
+// The segment meets the circle line: it reaches the closed disc and does
+// not lie strictly inside it.
+bool RefCircleMeets(const Pt& centre, int64_t radius, const Pt& a,
+                    const Pt& b) {
+  BigInt radius_squared = BigInt(radius) * BigInt(radius);
+  BigInt to_a = Norm(Sub(a, centre));
+  BigInt to_b = Norm(Sub(b, centre));
+  if (Compare(to_a, radius_squared) < 0 && Compare(to_b, radius_squared) < 0) {
+    return false;
+  }
+  BigVec along = Sub(b, a);
+  BigInt length_squared = Norm(along);
+  BigInt projection = Dot(Sub(centre, a), along);
+  if (length_squared.Sign() == 0 || projection.Sign() <= 0) {
+    return Compare(to_a, radius_squared) <= 0;
+  }
+  if (Compare(projection, length_squared) >= 0) {
+    return Compare(to_b, radius_squared) <= 0;
+  }
+  BigInt area = Cross(along, Sub(centre, a));
+  return Compare(area * area, radius_squared * length_squared) <= 0;
+}
+
+using Ring = std::vector<Pt>;
+
+template <typename Func>
+bool AnyEdge(const std::vector<Ring>& rings, Func func) {
+  for (const Ring& ring : rings) {
+    for (size_t i = 0; i < ring.size(); ++i) {
+      if (func(ring[i], ring[(i + 1) % ring.size()])) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+bool RefPolygonContains(const std::vector<Ring>& rings, const Pt& p) {
+  if (AnyEdge(rings, [&](const Pt& u, const Pt& v) {
+        return RefOnSegment(u, v, p);
+      })) {
+    return true;
+  }
+  // Even-odd count of the edges crossing the horizontal ray to the right.
+  bool inside = false;
+  AnyEdge(rings, [&](const Pt& u, const Pt& v) {
+    if ((u.y > p.y) != (v.y > p.y)) {
+      int side = Orientation(u, v, p);
+      inside ^= v.y > u.y ? side > 0 : side < 0;
+    }
+    return false;
+  });
+  return inside;
+}
+
+bool RefPolygonMeets(const std::vector<Ring>& rings, const Pt& a,
+                     const Pt& b) {
+  return AnyEdge(rings, [&](const Pt& u, const Pt& v) {
+    return RefSegmentsMeet(u, v, a, b);
+  });
+}
+
+size_t failures = 0;
+
+template <typename... Coords>
+void Check(bool actual, bool expected, const char* what, Coords... coords) {
+  if (actual == expected) {
+    return;
+  }
+  if (++failures <= 20) {
+    std::printf("MISMATCH %s: got %d, reference %d, coordinates", what,
+                actual, expected);
+    for (int64_t coord : {static_cast<int64_t>(coords)...}) {
+      std::printf(" %" PRId64, coord);
+    }
+    std::printf("\n");
+  }
+}
+
+// Draws inputs for one round at one scale, staying within 'limit'.
+class Source {
+ public:
+  Source(std::mt19937_64& rng, int64_t scale, int64_t limit)
+      : rng_(rng), scale_(scale), limit_(limit) {}
+
+  int64_t Below(uint64_t bound) { return static_cast<int64_t>(rng_() % bound); }
+
+  bool OneIn(uint64_t chance) { return rng_() % chance == 0; }
+
+  Pt Uniform() {
+    auto coord = [this] {
+      return Below(2 * static_cast<uint64_t>(scale_) + 1) - scale_;
+    };
+    return Pt{coord(), coord()};
+  }
+
+  Pt Near(const Pt& p) { return Clamp(p.x + Below(5) - 2, p.y + Below(5) - 2); }
+
+  // A lattice point of the line through 'a' and 'b', mostly between them,
+  // sometimes pushed one unit off the line.
+  Pt OnLine(const Pt& a, const Pt& b) {
+    __int128 dx = static_cast<__int128>(b.x) - a.x;
+    __int128 dy = static_cast<__int128>(b.y) - a.y;
+    unsigned __int128 step = Gcd(dx < 0 ? -dx : dx, dy < 0 ? -dy : dy);
+    if (step == 0) {
+      return Near(a);
+    }
+    __int128 multiple = static_cast<__int128>(rng_() % (step + 5)) - 2;
+    __int128 x = a.x + multiple * (dx / static_cast<__int128>(step));
+    __int128 y = a.y + multiple * (dy / static_cast<__int128>(step));
+    if (OneIn(4)) {
+      (OneIn(2) ? x : y) += OneIn(2) ? 1 : -1;
+    }
+    return Clamp(x, y);
+  }
+
+  // A point at distance 'radius' from 'centre' when one is easy to find:
+  // on an axis, or on a 3-4-5 triangle when the radius is a multiple of 5.
+  Pt OnCircle(const Pt& centre, int64_t radius) {
+    int64_t sign_x = OneIn(2) ? 1 : -1;
+    int64_t sign_y = OneIn(2) ? 1 : -1;
+    __int128 x = centre.x;
+    __int128 y = centre.y;
+    if (radius % 5 == 0 && OneIn(2)) {
+      int64_t unit = radius / 5;
+      bool swap = OneIn(2);
+      x += sign_x * static_cast<__int128>(unit) * (swap ? 4 : 3);
+      y += sign_y * static_cast<__int128>(unit) * (swap ? 3 : 4);
+    } else {
+      (OneIn(2) ? x : y) += sign_x * static_cast<__int128>(radius);
+    }
+    if (OneIn(4)) {
+      (OneIn(2) ? x : y) += OneIn(2) ? 1 : -1;
+    }
+    return Clamp(x, y);
+  }
+
+  int64_t Radius() {
+    switch (Below(4)) {
+      case 0:
+        return 0;
+      case 1:
+        return 5 * Below(static_cast<uint64_t>(scale_) / 5 + 1);
+      default:
+        return Below(static_cast<uint64_t>(scale_) + 1);
+    }
+  }
+
+ private:
+  static unsigned __int128 Gcd(unsigned __int128 left,
+                               unsigned __int128 right) {
+    while (right != 0) {
+      unsigned __int128 rest = left % right;
+      left = right;
+      right = rest;
+    }
+    return left;
+  }
+
+  Pt Clamp(__int128 x, __int128 y) const {
+    auto clamp = [this](__int128 coord) {
+      return static_cast<int64_t>(
+          std::clamp<__int128>(coord, -static_cast<__int128>(limit_), limit_));
+    };
+    return Pt{clamp(x), clamp(y)};
+  }
+
+  std::mt19937_64& rng_;
+  int64_t scale_;
+  int64_t limit_;
+};
+
+// Queries per round; odd, so the batch kernels run their scalar tails.
+const size_t kQueries = 37;
+
+template <typename Coord>
+void SegmentRound(std::mt19937_64& rng, int64_t scale, int64_t limit) {
+  using Point = BasicPoint<Coord>;
+  using Segment = BasicSegment<Coord>;
+  using Line = BasicLine<Coord>;
+  using Ray = BasicRay<Coord>;
+  using Circle = BasicCircle<Coord>;
+  using Radius = typename CoordTraits<Coord>::Radius;
+
+  Source source(rng, scale, limit);
+  Pt a = source.Uniform();
+  Pt b = source.OneIn(6) ? a : source.OneIn(4) ? source.Near(a)
+                                               : source.Uniform();
+  int64_t radius = source.Radius();
+  auto to_point = [](const Pt& p) {
+    return Point(static_cast<Coord>(p.x), static_cast<Coord>(p.y));
+  };
+  Segment segment(to_point(a), to_point(b));
+  Line line(to_point(a), to_point(b));
+  Ray ray(to_point(a), to_point(b));
+  Circle circle(to_point(a), static_cast<Radius>(radius));
+  ShapeArena arena(256);
+  const BasicShape<Coord>* clones[] = {
+      segment.CloneInto(arena), line.CloneInto(arena), ray.CloneInto(arena),
+      circle.CloneInto(arena)};
+  BasicPreparedSegment<Coord> prepared_segment(segment);
+  BasicPreparedLine<Coord> prepared_line(line);
+  BasicPreparedRay<Coord> prepared_ray(ray);
+  BasicPreparedCircle<Coord> prepared_circle(circle);
+
+  auto sample = [&]() {
+    switch (source.Below(7)) {
+      case 0:
+        return a;
+      case 1:
+        return b;
+      case 2:
+      case 3:
+        return source.OnLine(a, b);
+      case 4:
+        return source.OnCircle(a, radius);
+      case 5:
+        return source.Near(source.OneIn(2) ? a : b);
+      default:
+        return source.Uniform();
+    }
+  };
+
+  std::vector<Coord> xs, ys, ax, ay, bx, by;
+  std::vector<Pt> points, begins, ends;
+  for (size_t query = 0; query < kQueries; ++query) {
+    Pt p = sample();
+    Pt c = sample();
+    Pt d = source.OneIn(6) ? c : sample();
+    points.push_back(p);
+    begins.push_back(c);
+    ends.push_back(d);
+    xs.push_back(static_cast<Coord>(p.x));
+    ys.push_back(static_cast<Coord>(p.y));
+    ax.push_back(static_cast<Coord>(c.x));
+    ay.push_back(static_cast<Coord>(c.y));
+    bx.push_back(static_cast<Coord>(d.x));
+    by.push_back(static_cast<Coord>(d.y));
+
+    Point point = to_point(p);
+    Segment query_segment(to_point(c), to_point(d));
+    bool on_segment = RefOnSegment(a, b, p);
+    bool on_line = RefLineContains(a, b, p);
+    bool on_ray = RefRayContains(a, b, p);
+    bool in_circle = RefCircleContains(a, radius, p);
+    bool in_clone[] = {on_segment, on_line, on_ray, in_circle};
+    for (size_t i = 0; i < std::size(clones); ++i) {
+      Check(clones[i]->ContainsPoint(point), in_clone[i], "CloneInto::Contains",
+            i, a.x, a.y, b.x, b.y, radius, p.x, p.y);
+    }
+    Check(to_point(a).ContainsPoint(point), a == p, "Point::Contains",
+          a.x, a.y, p.x, p.y);
+    Check(segment.ContainsPoint(point), on_segment, "Segment::Contains", a.x,
+          a.y, b.x, b.y, p.x, p.y);
+    Check(prepared_segment.ContainsPoint(point), on_segment,
+          "PreparedSegment::Contains", a.x, a.y, b.x, b.y, p.x, p.y);
+    Check(line.ContainsPoint(point), on_line, "Line::Contains", a.x, a.y,
+          b.x, b.y, p.x, p.y);
+    Check(prepared_line.ContainsPoint(point), on_line,
+          "PreparedLine::Contains", a.x, a.y, b.x, b.y, p.x, p.y);
+    Check(ray.ContainsPoint(point), on_ray, "Ray::Contains", a.x, a.y, b.x,
+          b.y, p.x, p.y);
+    Check(prepared_ray.ContainsPoint(point), on_ray, "PreparedRay::Contains",
+          a.x, a.y, b.x, b.y, p.x, p.y);
+    Check(circle.ContainsPoint(point), in_circle, "Circle::Contains", a.x,
+          a.y, radius, p.x, p.y);
+    Check(prepared_circle.ContainsPoint(point), in_circle,
+          "PreparedCircle::Contains", a.x, a.y, radius, p.x, p.y);
+
+    bool point_meets = RefOnSegment(c, d, a);
+    bool segment_meets = RefSegmentsMeet(a, b, c, d);
+    bool line_meets = RefLineMeets(a, b, c, d);
+    bool ray_meets = RefRayMeets(a, b, c, d);
+    bool circle_meets = RefCircleMeets(a, radius, c, d);
+    Check(to_point(a).CrossSegment(query_segment), point_meets,
+          "Point::Cross", a.x, a.y, c.x, c.y, d.x, d.y);
+    Check(segment.CrossSegment(query_segment), segment_meets,
+          "Segment::Cross", a.x, a.y, b.x, b.y, c.x, c.y, d.x, d.y);
+    Check(prepared_segment.CrossSegment(query_segment), segment_meets,
+          "PreparedSegment::Cross", a.x, a.y, b.x, b.y, c.x, c.y, d.x, d.y);
+    Check(line.CrossSegment(query_segment), line_meets, "Line::Cross", a.x,
+          a.y, b.x, b.y, c.x, c.y, d.x, d.y);
+    Check(prepared_line.CrossSegment(query_segment), line_meets,
+          "PreparedLine::Cross", a.x, a.y, b.x, b.y, c.x, c.y, d.x, d.y);
+    Check(ray.CrossSegment(query_segment), ray_meets, "Ray::Cross", a.x, a.y,
+          b.x, b.y, c.x, c.y, d.x, d.y);
+    Check(prepared_ray.CrossSegment(query_segment), ray_meets,
+          "PreparedRay::Cross", a.x, a.y, b.x, b.y, c.x, c.y, d.x, d.y);
+    Check(circle.CrossSegment(query_segment), circle_meets, "Circle::Cross",
+          a.x, a.y, radius, c.x, c.y, d.x, d.y);
+    Check(prepared_circle.CrossSegment(query_segment), circle_meets,
+          "PreparedCircle::Cross", a.x, a.y, radius, c.x, c.y, d.x, d.y);
+  }
+
+  uint8_t out[kQueries];
+  segment.ContainsPoints(xs.data(), ys.data(), kQueries, out);
+  for (size_t i = 0; i < kQueries; ++i) {
+    Check(out[i], RefOnSegment(a, b, points[i]), "Segment::ContainsPoints",
+          a.x, a.y, b.x, b.y, points[i].x, points[i].y);
+  }
+  circle.ContainsPoints(xs.data(), ys.data(), kQueries, out);
+  for (size_t i = 0; i < kQueries; ++i) {
+    Check(out[i], RefCircleContains(a, radius, points[i]),
+          "Circle::ContainsPoints", a.x, a.y, radius, points[i].x,
+          points[i].y);
+  }
+  segment.CrossSegments(ax.data(), ay.data(), bx.data(), by.data(), kQueries,
+                        out);
+  for (size_t i = 0; i < kQueries; ++i) {
+    Check(out[i], RefSegmentsMeet(a, b, begins[i], ends[i]),
+          "Segment::CrossSegments", a.x, a.y, b.x, b.y, begins[i].x,
+          begins[i].y, ends[i].x, ends[i].y);
+  }
+  line.CrossSegments(ax.data(), ay.data(), bx.data(), by.data(), kQueries,
+                     out);
+  for (size_t i = 0; i < kQueries; ++i) {
+    Check(out[i], RefLineMeets(a, b, begins[i], ends[i]),
+          "Line::CrossSegments", a.x, a.y, b.x, b.y, begins[i].x, begins[i].y,
+          ends[i].x, ends[i].y);
+  }
+  ray.CrossSegments(ax.data(), ay.data(), bx.data(), by.data(), kQueries,
+                    out);
+  for (size_t i = 0; i < kQueries; ++i) {
+    Check(out[i], RefRayMeets(a, b, begins[i], ends[i]), "Ray::CrossSegments",
+          a.x, a.y, b.x, b.y, begins[i].x, begins[i].y, ends[i].x,
+          ends[i].y);
+  }
+}
+
+// A star-shaped polygon: vertices sorted by angle around a centre, every
+// turn between neighbours under half a circle, so the ring is simple.
+void PolygonRound(std::mt19937_64& rng, int64_t scale, int64_t limit) {
+  Source source(rng, scale / 2, limit);
+  Pt centre = source.Uniform();
+  std::vector<Pt> offsets;
+  size_t count = 3 + source.Below(10);
+  for (size_t i = 0; i < count; ++i) {
+    Pt p = source.Uniform();
+    if (p.x != 0 || p.y != 0) {
+      offsets.push_back(p);
+    }
+  }
+  Pt origin{0, 0};
+  auto half = [](const Pt& p) { return p.y < 0 || (p.y == 0 && p.x < 0); };
+  std::sort(offsets.begin(), offsets.end(), [&](const Pt& l, const Pt& r) {
+    if (half(l) != half(r)) {
+      return half(l) < half(r);
+    }
+    return Orientation(origin, l, r) > 0;
+  });
+  for (size_t i = 0; i < offsets.size(); ++i) {
+    if (Orientation(origin, offsets[i], offsets[(i + 1) % offsets.size()]) <=
+        0) {
+      return;
+    }
+  }
+  if (offsets.size() < 3) {
+    return;
+  }
+  Ring ring;
+  std::vector<Point> vertices;
+  for (const Pt& offset : offsets) {
+    ring.push_back(Pt{centre.x + offset.x, centre.y + offset.y});
+    vertices.emplace_back(ring.back().x, ring.back().y);
+  }
+  std::vector<Ring> rings{ring};
+  Polygon polygon(vertices);
+  Polygon prepared(vertices);
+  prepared.Prepare();
+  ShapeArena arena;
+  const IShape* clone = prepared.CloneInto(arena);
+
+  auto sample = [&]() {
+    const Pt& u = ring[source.Below(ring.size())];
+    const Pt& v = ring[source.Below(ring.size())];
+    switch (source.Below(5)) {
+      case 0:
+        return u;
+      case 1:
+        return source.Near(u);
+      case 2:
+        return source.OnLine(u, v);
+      default:
+        return source.Uniform();
+    }
+  };
+  for (size_t query = 0; query < kQueries; ++query) {
+    Pt p = sample();
+    bool inside = RefPolygonContains(rings, p);
+    Check(polygon.ContainsPoint(Point(p.x, p.y)), inside, "Polygon::Contains",
+          centre.x, centre.y, p.x, p.y);
+    Check(prepared.ContainsPoint(Point(p.x, p.y)), inside,
+          "Polygon::Contains prepared", centre.x, centre.y, p.x, p.y);
+    Check(clone->ContainsPoint(Point(p.x, p.y)), inside,
+          "Polygon::CloneInto", centre.x, centre.y, p.x, p.y);
+    Pt c = sample();
+    Pt d = sample();
+    Check(polygon.CrossSegment(Segment(Point(c.x, c.y), Point(d.x, d.y))),
+          RefPolygonMeets(rings, c, d), "Polygon::Cross", centre.x, centre.y,
+          c.x, c.y, d.x, d.y);
+  }
+}
+
+// A short query segment anywhere up to the scale, tiny cells, and points,
+// segments and circles on or beside it: the grid must report exactly the
+// shapes a scan of all of them finds crossing.
+void GridRound(std::mt19937_64& rng, int64_t scale, int64_t limit) {
+  Source source(rng, scale, limit);
+  Pt a = source.Uniform();
+  Pt b{a.x + source.Below(81) - 40, a.y + source.Below(81) - 40};
+  int64_t cell_size = 1 + source.Below(source.OneIn(2) ? 3 : 64);
+  Segment query(Point(a.x, a.y), Point(b.x, b.y));
+  std::vector<Point> points;
+  std::vector<Segment> segments;
+  std::vector<Circle> circles;
+  for (size_t i = 0; i < kQueries; ++i) {
+    Pt p = source.OnLine(a, b);
+    Pt q = source.Near(p);
+    points.emplace_back(p.x, p.y);
+    segments.emplace_back(Point(p.x, p.y), Point(q.x, q.y));
+    circles.emplace_back(Point(q.x, q.y), source.Below(3));
+  }
+  ShapeGrid grid(cell_size);
+  std::vector<const IShape*> expected;
+  auto add = [&](const IShape& shape) {
+    grid.Insert(&shape);
+    if (shape.CrossSegment(query)) {
+      expected.push_back(&shape);
+    }
+  };
+  for (size_t i = 0; i < kQueries; ++i) {
+    add(points[i]);
+    add(segments[i]);
+    add(circles[i]);
+  }
+  std::vector<const IShape*> found = grid.QueryCrossing(query);
+  std::sort(expected.begin(), expected.end());
+  std::sort(found.begin(), found.end());
+  Check(found == expected, true, "ShapeGrid::QueryCrossing", a.x, a.y, b.x,
+        b.y, cell_size, found.size(), expected.size());
+}
+
+// Objects that create others in the arena from their constructor, one of
+// them failing after it did. Each finished object is destroyed once, the
+// outer ones before what they created.
+struct ArenaInner {
+  ArenaInner(std::vector<int>& log, int id)
+      : log(log), id(id), payload(4, id) {}
+
+  ~ArenaInner() { log.push_back(id); }
+
+  std::vector<int>& log;
+  int id;
+  std::vector<int> payload;
+};
+
+struct ArenaOuter {
+  ArenaOuter(ShapeArena& arena, std::vector<int>& log, int id, bool fail)
+      : log(log),
+        id(id),
+        inner(arena.Create<ArenaInner>(log, id + 1)),
+        payload(4, id) {
+    if (fail) {
+      throw std::runtime_error("ArenaOuter");
+    }
+  }
+
+  ~ArenaOuter() { log.push_back(id); }
+
+  std::vector<int>& log;
+  int id;
+  ArenaInner* inner;
+  std::vector<int> payload;
+};
+
+void ArenaNesting() {
+  std::vector<int> log;
+  ShapeArena arena(64);
+  for (int round = 0; round < 2; ++round) {
+    log.clear();
+    arena.Create<ArenaOuter>(arena, log, 0, false);
+    try {
+      arena.Create<ArenaOuter>(arena, log, 2, true);
+    } catch (const std::runtime_error&) {
+    }
+    ArenaOuter* last = arena.Create<ArenaOuter>(arena, log, 4, false);
+    Check(last->inner->id == 5 && arena.ObjectCount() == 5, true,
+          "ShapeArena nested Create", round);
+    arena.Clear();
+    Check(log == std::vector<int>{4, 5, 3, 0, 1}, true,
+          "ShapeArena nested Clear", round);
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  size_t rounds = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000;
+  uint64_t seed = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1;
+  std::mt19937_64 rng(seed);
+  ArenaNesting();
+  // int64_t is exact below 2^62 and int32_t below 2^30.
+  const int64_t limit64 = (int64_t{1} << 62) - 1;
+  const int64_t limit32 = (int64_t{1} << 30) - 1;
+  const int64_t scales[] = {2,
+                            8,
+                            1000,
+                            int64_t{1} << 20,
+                            int64_t{1} << 29,
+                            int64_t{1} << 40,
+                            int64_t{1} << 61};
+  for (size_t round = 0; round < rounds; ++round) {
+    int64_t scale = scales[rng() % std::size(scales)];
+    SegmentRound<int64_t>(rng, scale, limit64);
+    if (scale <= (int64_t{1} << 29)) {
+      SegmentRound<int32_t>(rng, scale, limit32);
+    }
+    if (round % 4 == 0) {
+      PolygonRound(rng, scale, limit64);
+    }
+    if (round % 2 == 0) {
+      GridRound(rng, scale, limit64);
+    }
+  }
+  std::printf("%zu rounds, seed %" PRIu64 ": %zu mismatches\n", rounds, seed,
+              failures);
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,348 @@
+#include "intersection.hpp"
+
+#include <vector>
+
+#include "polygon.hpp"
+
+namespace {
+
+using Square = CoordTraits<int64_t>::Square;
+
+bool IsZero(const Vector& vect) { return vect.GetX() == 0 && vect.GetY() == 0; }
+
+Vector Direction(const Line& line) {
+  return Vector(line.GetSecond() - line.GetFirst());
+}
+
+Segment EdgeSegment(const Vector& first, const Vector& second) {
+  return Segment(Point(first), Point(second));
+}
+
+// Whether the point of [a, b] nearest 'centre' is within the radius.
+bool NearCentre(const Vector& a_v, const Vector& b_v, const Vector& centre,
+                Square radius_squared) {
+  Vector ab_vect = b_v - a_v;
+  Vector ac_vect = centre - a_v;
+  if (DotSign(ac_vect, ab_vect) <= 0) {
+    return CompareValues<int64_t>(SquaredLength(ac_vect), radius_squared) <= 0;
+  }
+  Vector bc_vect = centre - b_v;
+  if (DotSign(bc_vect, -ab_vect) <= 0) {
+    return CompareValues<int64_t>(SquaredLength(bc_vect), radius_squared) <= 0;
+  }
+  // Past neither end: dist^2 * |ab|^2 <= r^2 * |ab|^2.
+  Square area_abs = AbsWide<int64_t>(WideCross(ab_vect, ac_vect));
+  return CompareSquareProducts<int64_t>(area_abs, area_abs, radius_squared,
+                                        SquaredLength(ab_vect)) <= 0;
+}
+
+// Whether the line through 'origin' along 'direct' passes within the
+// radius of the centre; 'direct' is not zero.
+bool LineNearCentre(const Vector& origin, const Vector& direct,
+                    const Circle& circle) {
+  Square area_abs = AbsWide<int64_t>(
+      WideCross(direct, Vector(circle.GetCentre()) - origin));
+  return CompareSquareProducts<int64_t>(area_abs, area_abs,
+                                        circle.RadiusSquared(),
+                                        SquaredLength(direct)) <= 0;
+}
+
+bool SegmentCircle(const Segment& segment, const Circle& circle) {
+  return NearCentre(Vector(segment.GetA()), Vector(segment.GetB()),
+                    Vector(circle.GetCentre()), circle.RadiusSquared());
+}
+
+// Inside, or crossing the boundary.
+bool SegmentPolygon(const Segment& segment, const Polygon& polygon) {
+  return polygon.ContainsPoint(segment.GetA()) ||
+         polygon.CrossSegment(segment);
+}
+
+bool LineLine(const Line& first, const Line& second) {
+  Vector first_direct = Direction(first);
+  Vector second_direct = Direction(second);
+  if (IsZero(first_direct) || IsZero(second_direct) ||
+      CrossSign(first_direct, second_direct) != 0) {
+    return true;
+  }
+  return first.ContainsPoint(second.GetFirst());
+}
+
+// The ray starts on the line or points towards it.
+bool LineRay(const Line& line, const Ray& ray) {
+  Vector direct = Direction(line);
+  if (IsZero(direct) || IsZero(ray.GetVector())) {
+    return true;
+  }
+  int start_side =
+      CrossSign(direct, Vector(ray.GetA() - line.GetFirst()));
+  return start_side == 0 || start_side * CrossSign(direct, ray.GetVector()) < 0;
+}
+
+bool LineCircle(const Line& line, const Circle& circle) {
+  Vector direct = Direction(line);
+  return IsZero(direct) ||
+         LineNearCentre(Vector(line.GetFirst()), direct, circle);
+}
+
+// A line meets a polygon unless every vertex is strictly on one side.
+bool LinePolygon(const Line& line, const Polygon& polygon) {
+  Vector direct = Direction(line);
+  if (IsZero(direct)) {
+    return true;
+  }
+  Vector origin(line.GetFirst());
+  int side = 0;
+  return polygon.ForEachEdge([&](const Vector& vertex, const Vector&) {
+    int sign = CrossSign(direct, vertex - origin);
+    if (sign == 0 || sign == -side) {
+      return true;
+    }
+    side = sign;
+    return false;
+  });
+}
+
+bool RayRay(const Ray& first, const Ray& second) {
+  if (first.ContainsPoint(second.GetA()) ||
+      second.ContainsPoint(first.GetA())) {
+    return true;
+  }
+  // Neither start is on the other ray, so parallel rays miss. Otherwise
+  // the lines meet at first + t * u = second + s * v, where
+  // t = (w x v) / (u x v) and s = (w x u) / (u x v), w = second - first.
+  Vector u_vect = first.GetVector();
+  Vector v_vect = second.GetVector();
+  int denominator = CrossSign(u_vect, v_vect);
+  if (denominator == 0) {
+    return false;
+  }
+  Vector w_vect(second.GetA() - first.GetA());
+  return CrossSign(w_vect, v_vect) * denominator >= 0 &&
+         CrossSign(w_vect, u_vect) * denominator >= 0;
+}
+
+// Starting outside, the ray must point towards the centre and pass within
+// the radius of it.
+bool RayCircle(const Ray& ray, const Circle& circle) {
+  Vector direct = ray.GetVector();
+  if (IsZero(direct) || circle.ContainsPoint(ray.GetA())) {
+    return true;
+  }
+  Vector origin(ray.GetA());
+  return DotSign(Vector(circle.GetCentre()) - origin, direct) > 0 &&
+         LineNearCentre(origin, direct, circle);
+}
+
+bool RayPolygon(const Ray& ray, const Polygon& polygon) {
+  if (IsZero(ray.GetVector()) || polygon.ContainsPoint(ray.GetA())) {
+    return true;
+  }
+  return polygon.ForEachEdge([&ray](const Vector& first, const Vector& second) {
+    return ray.CrossSegment(EdgeSegment(first, second));
+  });
+}
+
+// |c1 - c2| <= r1 + r2. The sum of two size_t radii may need 65 bits; from
+// 2^64 on its square exceeds every squared distance.
+bool CircleCircle(const Circle& first, const Circle& second) {
+  unsigned __int128 radii =
+      static_cast<unsigned __int128>(first.GetRadius()) + second.GetRadius();
+  if (radii >> 64 != 0) {
+    return true;
+  }
+  return CompareValues<int64_t>(
+             SquaredLength(Vector(first.GetCentre() - second.GetCentre())),
+             radii * radii) <= 0;
+}
+
+bool CirclePolygon(const Circle& circle, const Polygon& polygon) {
+  if (polygon.ContainsPoint(circle.GetCentre())) {
+    return true;
+  }
+  Vector centre(circle.GetCentre());
+  Square radius_squared = circle.RadiusSquared();
+  return polygon.ForEachEdge([&](const Vector& first, const Vector& second) {
+    return NearCentre(first, second, centre, radius_squared);
+  });
+}
+
+Point FirstVertex(const Polygon& polygon) {
+  Point vertex(0, 0);
+  polygon.ForEachEdge([&vertex](const Vector& first, const Vector&) {
+    vertex = Point(first);
+    return true;
+  });
+  return vertex;
+}
+
+// Crossing boundaries, or one inside the other. If the boundaries do not
+// cross, each lies wholly inside or outside the other polygon, so one
+// vertex of each decides.
+bool PolygonPolygon(const Polygon& first, const Polygon& second) {
+  thread_local std::vector<Segment> first_edges;
+  thread_local std::vector<Segment> second_edges;
+  auto collect = [](const Polygon& polygon, const BoundingBox& box,
+                    std::vector<Segment>& edges) {
+    edges.clear();
+    polygon.ForEachEdge([&](const Vector& begin, const Vector& end) {
+      Segment edge = EdgeSegment(begin, end);
+      if (box.Overlaps(edge.GetBoundingBox())) {
+        edges.push_back(edge);
+      }
+      return false;
+    });
+  };
+  collect(first, second.GetBoundingBox(), first_edges);
+  collect(second, first.GetBoundingBox(), second_edges);
+  for (const Segment& first_edge : first_edges) {
+    for (const Segment& second_edge : second_edges) {
+      if (first_edge.CrossSegment(second_edge)) {
+        return true;
+      }
+    }
+  }
+  return second.ContainsPoint(FirstVertex(first)) ||
+         first.ContainsPoint(FirstVertex(second));
+}
+
+// One row of the matrix each: 'shape' against any kind.
+bool Against(const Point& point, const IShape& other) {
+  return other.ContainsPoint(point);
+}
+
+bool Against(const Segment& segment, const IShape& other) {
+  switch (other.GetKind()) {
+    case ShapeKind::kPoint:
+      return segment.ContainsPoint(static_cast<const Point&>(other));
+    case ShapeKind::kSegment:
+    case ShapeKind::kLine:
+    case ShapeKind::kRay:
+      return other.CrossSegment(segment);
+    case ShapeKind::kCircle:
+      return SegmentCircle(segment, static_cast<const Circle&>(other));
+    case ShapeKind::kPolygon:
+      return SegmentPolygon(segment, static_cast<const Polygon&>(other));
+  }
+  return false;
+}
+
+bool Against(const Line& line, const IShape& other) {
+  switch (other.GetKind()) {
+    case ShapeKind::kPoint:
+      return line.ContainsPoint(static_cast<const Point&>(other));
+    case ShapeKind::kSegment:
+      return line.CrossSegment(static_cast<const Segment&>(other));
+    case ShapeKind::kLine:
+      return LineLine(line, static_cast<const Line&>(other));
+    case ShapeKind::kRay:
+      return LineRay(line, static_cast<const Ray&>(other));
+    case ShapeKind::kCircle:
+      return LineCircle(line, static_cast<const Circle&>(other));
+    case ShapeKind::kPolygon:
+      return LinePolygon(line, static_cast<const Polygon&>(other));
+  }
+  return false;
+}
+
+bool Against(const Ray& ray, const IShape& other) {
+  switch (other.GetKind()) {
+    case ShapeKind::kPoint:
+      return ray.ContainsPoint(static_cast<const Point&>(other));
+    case ShapeKind::kSegment:
+      return ray.CrossSegment(static_cast<const Segment&>(other));
+    case ShapeKind::kLine:
+      return LineRay(static_cast<const Line&>(other), ray);
+    case ShapeKind::kRay:
+      return RayRay(ray, static_cast<const Ray&>(other));
+    case ShapeKind::kCircle:
+      return RayCircle(ray, static_cast<const Circle&>(other));
+    case ShapeKind::kPolygon:
+      return RayPolygon(ray, static_cast<const Polygon&>(other));
+  }
+  return false;
+}
+
+bool Against(const Circle& circle, const IShape& other) {
+  switch (other.GetKind()) {
+    case ShapeKind::kPoint:
+      return circle.ContainsPoint(static_cast<const Point&>(other));
+    case ShapeKind::kSegment:
+      return SegmentCircle(static_cast<const Segment&>(other), circle);
+    case ShapeKind::kLine:
+      return LineCircle(static_cast<const Line&>(other), circle);
+    case ShapeKind::kRay:
+      return RayCircle(static_cast<const Ray&>(other), circle);
+    case ShapeKind::kCircle:
+      return CircleCircle(circle, static_cast<const Circle&>(other));
+    case ShapeKind::kPolygon:
+      return CirclePolygon(circle, static_cast<const Polygon&>(other));
+  }
+  return false;
+}
+
+bool Against(const Polygon& polygon, const IShape& other) {
+  switch (other.GetKind()) {
+    case ShapeKind::kPoint:
+      return polygon.ContainsPoint(static_cast<const Point&>(other));
+    case ShapeKind::kSegment:
+      return SegmentPolygon(static_cast<const Segment&>(other), polygon);
+    case ShapeKind::kLine:
+      return LinePolygon(static_cast<const Line&>(other), polygon);
+    case ShapeKind::kRay:
+      return RayPolygon(static_cast<const Ray&>(other), polygon);
+    case ShapeKind::kCircle:
+      return CirclePolygon(static_cast<const Circle&>(other), polygon);
+    case ShapeKind::kPolygon:
+      return PolygonPolygon(polygon, static_cast<const Polygon&>(other));
+  }
+  return false;
+}
+
+template <typename Shape>
+void AgainstEach(const Shape& shape, const IShape* const* others,
+                 size_t count, uint8_t* out) {
+  BoundingBox box = shape.GetBoundingBox();
+  for (size_t i = 0; i < count; ++i) {
+    out[i] = box.Overlaps(others[i]->GetBoundingBox()) &&
+             Against(shape, *others[i]);
+  }
+}
+
+// Calls func(shape) with 'shape' cast to its concrete type.
+template <typename Func>
+auto Visit(const IShape& shape, Func func) {
+  switch (shape.GetKind()) {
+    case ShapeKind::kPoint:
+      return func(static_cast<const Point&>(shape));
+    case ShapeKind::kSegment:
+      return func(static_cast<const Segment&>(shape));
+    case ShapeKind::kLine:
+      return func(static_cast<const Line&>(shape));
+    case ShapeKind::kRay:
+      return func(static_cast<const Ray&>(shape));
+    case ShapeKind::kCircle:
+      return func(static_cast<const Circle&>(shape));
+    case ShapeKind::kPolygon:
+      break;
+  }
+  return func(static_cast<const Polygon&>(shape));
+}
+
+}  // namespace
+
+bool Intersects(const IShape& first, const IShape& second) {
+  if (!first.GetBoundingBox().Overlaps(second.GetBoundingBox())) {
+    return false;
+  }
+  return Visit(first, [&second](const auto& shape) {
+    return Against(shape, second);
+  });
+}
+
+void Intersects(const IShape& shape, const IShape* const* others,
+                size_t count, uint8_t* out) {
+  Visit(shape, [=](const auto& concrete) {
+    AgainstEach(concrete, others, count, out);
+  });
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#include "geometry.hpp"
+
+// Whether two shapes share a point, for every pair of shape kinds. Points,
+// segments, lines and rays are the point sets their ContainsPoint accepts,
+// so a degenerate line or ray covers the plane. Circles and polygons are
+// solid, boundary included: a segment inside a circle intersects it,
+// although Circle::CrossSegment, which tests the boundary, is false.
+//
+// Bounding boxes reject first. Circles then compare squared distances,
+// and linear shapes take orientation signs, in constant time. A polygon
+// walks its edges against another kind and checks edge pairs, those in
+// the other's box, against another polygon. Exact for coordinates below
+// 2^62.
+bool Intersects(const IShape& first, const IShape& second);
+
+// One against many: out[i] is 1 if 'shape' intersects *others[i] and 0
+// otherwise. The kind and box of 'shape' are looked up once.
+void Intersects(const IShape& shape, const IShape* const* others,
+                size_t count, uint8_t* out);
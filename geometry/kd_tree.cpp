@@ -0,0 +1,200 @@
+#include "kd_tree.hpp"
+
+#include <algorithm>
+
+namespace {
+
+// Squared distance from a coordinate to a splitting line.
+unsigned __int128 SquaredGap(int64_t coord, int64_t split) {
+  return SquaredLength(Vector(coord - split, 0));
+}
+
+}  // namespace
+
+KdTree::KdTree(const std::vector<Point>& points) {
+  std::vector<Slot> slots;
+  slots.reserve(points.size());
+  for (size_t id = 0; id < points.size(); ++id) {
+    slots.push_back(Slot{points[id].GetX(), points[id].GetY(), id});
+  }
+  Build(slots, 0, slots.size(), 0);
+  points_.reserve(slots.size());
+  ids_.reserve(slots.size());
+  for (const Slot& slot : slots) {
+    points_.emplace_back(slot.xcord, slot.ycord);
+    ids_.push_back(slot.id);
+  }
+}
+
+void KdTree::Build(std::vector<Slot>& slots, size_t begin, size_t end,
+                   size_t depth) {
+  if (end - begin <= kLeafSize) {
+    return;
+  }
+  size_t middle = begin + (end - begin) / 2;
+  std::nth_element(slots.begin() + begin, slots.begin() + middle,
+                   slots.begin() + end,
+                   [depth](const Slot& left, const Slot& right) {
+                     return depth % 2 == 0 ? left.xcord < right.xcord
+                                           : left.ycord < right.ycord;
+                   });
+  Build(slots, begin, middle, depth + 1);
+  Build(slots, middle + 1, end, depth + 1);
+}
+
+unsigned __int128 KdTree::SquaredDistance(size_t slot,
+                                          const Point& target) const {
+  return SquaredLength(points_[slot] - Vector(target));
+}
+
+std::vector<size_t> KdTree::Nearest(const Point& target, size_t k) const {
+  std::vector<size_t> out;
+  Nearest(target, k, out);
+  return out;
+}
+
+std::vector<size_t> KdTree::InRadius(const Circle& circle) const {
+  std::vector<size_t> out;
+  InRadius(circle, out);
+  return out;
+}
+
+std::vector<size_t> KdTree::InBox(const BoundingBox& box) const {
+  std::vector<size_t> out;
+  InBox(box, out);
+  return out;
+}
+
+void KdTree::Nearest(const Point& target, size_t k,
+                     std::vector<size_t>& out) const {
+  out.clear();
+  if (k == 0) {
+    return;
+  }
+  // A max-heap of the best k so far, kept per thread across queries.
+  thread_local std::vector<Candidate> heap;
+  heap.clear();
+  SearchNearest(0, points_.size(), 0, target, k, heap);
+  std::sort_heap(heap.begin(), heap.end());
+  for (const Candidate& candidate : heap) {
+    out.push_back(candidate.second);
+  }
+}
+
+void KdTree::InRadius(const Circle& circle, std::vector<size_t>& out) const {
+  out.clear();
+  SearchRadius(0, points_.size(), 0, circle.GetCentre(), circle.RadiusSquared(),
+               out);
+}
+
+void KdTree::InBox(const BoundingBox& box, std::vector<size_t>& out) const {
+  out.clear();
+  SearchBox(0, points_.size(), 0, box, out);
+}
+
+// Points equal to a split value may sit on either side of it, so both
+// sides are searched whenever the query reaches the splitting line.
+void KdTree::SearchNearest(size_t begin, size_t end, size_t depth,
+                           const Point& target, size_t k,
+                           std::vector<Candidate>& heap) const {
+  auto offer = [&](size_t slot) {
+    unsigned __int128 distance = SquaredDistance(slot, target);
+    if (heap.size() == k && distance > heap.front().first) {
+      return;
+    }
+    Candidate candidate(distance, ids_[slot]);
+    if (heap.size() < k) {
+      heap.push_back(candidate);
+      std::push_heap(heap.begin(), heap.end());
+    } else if (candidate < heap.front()) {
+      std::pop_heap(heap.begin(), heap.end());
+      heap.back() = candidate;
+      std::push_heap(heap.begin(), heap.end());
+    }
+  };
+  if (end - begin <= kLeafSize) {
+    for (size_t slot = begin; slot < end; ++slot) {
+      offer(slot);
+    }
+    return;
+  }
+  size_t middle = begin + (end - begin) / 2;
+  // Both children's split points are fetched while this node is handled;
+  // below the top levels each is a cache miss.
+  __builtin_prefetch(&points_[begin + (middle - begin) / 2]);
+  __builtin_prefetch(&points_[middle + 1 + (end - middle - 1) / 2]);
+  int64_t coord = depth % 2 == 0 ? target.GetX() : target.GetY();
+  int64_t split = depth % 2 == 0 ? points_[middle].GetX()
+                                : points_[middle].GetY();
+  bool left_first = coord <= split;
+  if (left_first) {
+    SearchNearest(begin, middle, depth + 1, target, k, heap);
+  } else {
+    SearchNearest(middle + 1, end, depth + 1, target, k, heap);
+  }
+  offer(middle);
+  if (heap.size() < k || SquaredGap(coord, split) <= heap.front().first) {
+    if (left_first) {
+      SearchNearest(middle + 1, end, depth + 1, target, k, heap);
+    } else {
+      SearchNearest(begin, middle, depth + 1, target, k, heap);
+    }
+  }
+}
+
+void KdTree::SearchRadius(size_t begin, size_t end, size_t depth,
+                          const Point& centre,
+                          unsigned __int128 radius_squared,
+                          std::vector<size_t>& out) const {
+  if (end - begin <= kLeafSize) {
+    for (size_t slot = begin; slot < end; ++slot) {
+      if (SquaredDistance(slot, centre) <= radius_squared) {
+        out.push_back(ids_[slot]);
+      }
+    }
+    return;
+  }
+  size_t middle = begin + (end - begin) / 2;
+  __builtin_prefetch(&points_[begin + (middle - begin) / 2]);
+  __builtin_prefetch(&points_[middle + 1 + (end - middle - 1) / 2]);
+  int64_t coord = depth % 2 == 0 ? centre.GetX() : centre.GetY();
+  int64_t split = depth % 2 == 0 ? points_[middle].GetX()
+                                : points_[middle].GetY();
+  bool reaches = SquaredGap(coord, split) <= radius_squared;
+  if (coord <= split || reaches) {
+    SearchRadius(begin, middle, depth + 1, centre, radius_squared, out);
+  }
+  if (SquaredDistance(middle, centre) <= radius_squared) {
+    out.push_back(ids_[middle]);
+  }
+  if (coord >= split || reaches) {
+    SearchRadius(middle + 1, end, depth + 1, centre, radius_squared, out);
+  }
+}
+
+void KdTree::SearchBox(size_t begin, size_t end, size_t depth,
+                       const BoundingBox& box,
+                       std::vector<size_t>& out) const {
+  if (end - begin <= kLeafSize) {
+    for (size_t slot = begin; slot < end; ++slot) {
+      if (box.Contains(points_[slot].GetX(), points_[slot].GetY())) {
+        out.push_back(ids_[slot]);
+      }
+    }
+    return;
+  }
+  size_t middle = begin + (end - begin) / 2;
+  int64_t low = depth % 2 == 0 ? box.min_x : box.min_y;
+  int64_t high = depth % 2 == 0 ? box.max_x : box.max_y;
+  int64_t split = depth % 2 == 0 ? points_[middle].GetX()
+                                : points_[middle].GetY();
+  if (low <= split) {
+    SearchBox(begin, middle, depth + 1, box, out);
+  }
+  if (box.Contains(points_[middle].GetX(), points_[middle].GetY())) {
+    out.push_back(ids_[middle]);
+  }
+  if (high >= split) {
+    SearchBox(middle + 1, end, depth + 1, box, out);
+  }
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "geometry.hpp"
+
+// Static 2-d tree over points, built once in O(N log N). The tree is
+// implicit: the points are stored in one array ordered so that the middle
+// element of every range is its median, splitting x and y alternately by
+// depth. A subtree is a contiguous range, and ranges of at most kLeafSize
+// points are scanned. Distances are exact
+// squared int64_t distances, compared as Circle does. Results are indices
+// into the points the tree was built from.
+class KdTree {
+ public:
+  explicit KdTree(const std::vector<Point>& points);
+
+  size_t Size() const { return points_.size(); }
+
+  // The k points nearest to 'target', nearest first, ties by index.
+  std::vector<size_t> Nearest(const Point& target, size_t k) const;
+
+  // The points Circle::ContainsPoint accepts, boundary included.
+  std::vector<size_t> InRadius(const Circle& circle) const;
+
+  // The points inside 'box', bounds inclusive.
+  std::vector<size_t> InBox(const BoundingBox& box) const;
+
+  // The same, replacing the contents of 'out' so its storage is reused
+  // across queries.
+  void Nearest(const Point& target, size_t k, std::vector<size_t>& out) const;
+
+  void InRadius(const Circle& circle, std::vector<size_t>& out) const;
+
+  void InBox(const BoundingBox& box, std::vector<size_t>& out) const;
+
+ private:
+  using Candidate = std::pair<unsigned __int128, size_t>;
+
+  struct Slot {
+    int64_t xcord;
+    int64_t ycord;
+    size_t id;
+  };
+
+  static const size_t kLeafSize = 8;
+
+  void Build(std::vector<Slot>& slots, size_t begin, size_t end,
+             size_t depth);
+
+  unsigned __int128 SquaredDistance(size_t slot, const Point& target) const;
+
+  void SearchNearest(size_t begin, size_t end, size_t depth,
+                     const Point& target, size_t k,
+                     std::vector<Candidate>& heap) const;
+
+  void SearchRadius(size_t begin, size_t end, size_t depth,
+                    const Point& centre, unsigned __int128 radius_squared,
+                    std::vector<size_t>& out) const;
+
+  void SearchBox(size_t begin, size_t end, size_t depth,
+                 const BoundingBox& box, std::vector<size_t>& out) const;
+
+  std::vector<Vector> points_;
+  std::vector<size_t> ids_;
+};
@@ -0,0 +1,253 @@
+#include "polygon.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+namespace {
+
+int Orientation(const Vector& first, const Vector& second,
+                const Vector& point) {
+  return CrossSign(second - first, point - first);
+}
+
+}  // namespace
+
+Polygon::Polygon(const std::vector<Point>& outer,
+                 const std::vector<std::vector<Point>>& holes) {
+  AddRing(outer);
+  for (const std::vector<Point>& hole : holes) {
+    AddRing(hole);
+  }
+  box_ = BoundingBox{vertices_[0].GetX(), vertices_[0].GetY(),
+                     vertices_[0].GetX(), vertices_[0].GetY()};
+  for (const Vector& vertex : vertices_) {
+    box_.min_x = std::min(box_.min_x, vertex.GetX());
+    box_.min_y = std::min(box_.min_y, vertex.GetY());
+    box_.max_x = std::max(box_.max_x, vertex.GetX());
+    box_.max_y = std::max(box_.max_y, vertex.GetY());
+  }
+}
+
+void Polygon::AddRing(const std::vector<Point>& ring) {
+  if (ring.size() < 3) {
+    throw std::invalid_argument("Polygon: a ring needs three vertices");
+  }
+  for (const Point& vertex : ring) {
+    vertices_.emplace_back(vertex);
+  }
+  ring_ends_.push_back(vertices_.size());
+}
+
+std::vector<Point> Polygon::GetRing(size_t index) const {
+  if (index >= ring_ends_.size()) {
+    throw std::out_of_range("Polygon::GetRing: no such ring");
+  }
+  size_t begin = index == 0 ? 0 : ring_ends_[index - 1];
+  std::vector<Point> ring;
+  ring.reserve(ring_ends_[index] - begin);
+  for (size_t i = begin; i < ring_ends_[index]; ++i) {
+    ring.emplace_back(vertices_[i]);
+  }
+  return ring;
+}
+
+void Polygon::Move(const Vector& vector) {
+  for (Vector& vertex : vertices_) {
+    vertex += vector;
+  }
+  box_ = BoundingBox{box_.min_x + vector.GetX(), box_.min_y + vector.GetY(),
+                     box_.max_x + vector.GetX(), box_.max_y + vector.GetY()};
+  for (Edge& edge : edges_) {
+    edge.left += vector;
+    edge.right += vector;
+  }
+  for (int64_t& xcord : slab_x_) {
+    xcord += vector.GetX();
+  }
+  for (std::pair<int64_t, int64_t>& span : column_spans_) {
+    span.first += vector.GetY();
+    span.second += vector.GetY();
+  }
+}
+
+// Even-odd count of the edges above the point. Each edge covers the
+// half-open x-range [left, right), so a vertex is counted once and a
+// vertical edge never.
+bool Polygon::ContainsPoint(const Point& point) const {
+  if (!box_.Contains(point.GetX(), point.GetY())) {
+    return false;
+  }
+  Vector target(point);
+  if (IsPrepared()) {
+    return PreparedContains(target);
+  }
+  bool inside = false;
+  bool on_boundary = ForEachEdge([&](const Vector& first,
+                                     const Vector& second) {
+    int64_t low_x = std::min(first.GetX(), second.GetX());
+    int64_t high_x = std::max(first.GetX(), second.GetX());
+    if (target.GetX() < low_x || high_x < target.GetX()) {
+      return false;
+    }
+    int side = Orientation(first, second, target);
+    if (side == 0 && std::min(first.GetY(), second.GetY()) <= target.GetY() &&
+        target.GetY() <= std::max(first.GetY(), second.GetY())) {
+      return true;
+    }
+    if (target.GetX() < high_x) {
+      int above = first.GetX() < second.GetX() ? side : -side;
+      if (above < 0) {
+        inside = !inside;
+      }
+    }
+    return false;
+  });
+  return on_boundary || inside;
+}
+
+bool Polygon::CrossSegment(const Segment& segment) const {
+  if (!box_.Overlaps(segment.GetBoundingBox())) {
+    return false;
+  }
+  return ForEachEdge([&segment](const Vector& first, const Vector& second) {
+    return segment.CrossSegment(Segment(Point(first), Point(second)));
+  });
+}
+
+// Edges spanning a common slab do not cross inside it. They are compared
+// where the later of them starts, by testing its left endpoint against the
+// other; an endpoint they share there defers to where the first one ends.
+bool Polygon::EdgeBelow(const Edge& lower, const Edge& upper) {
+  int side = 0;
+  if (lower.left.GetX() >= upper.left.GetX()) {
+    side = -Orientation(upper.left, upper.right, lower.left);
+  } else {
+    side = Orientation(lower.left, lower.right, upper.left);
+  }
+  if (side == 0) {
+    if (lower.right.GetX() <= upper.right.GetX()) {
+      side = -Orientation(upper.left, upper.right, lower.right);
+    } else {
+      side = Orientation(lower.left, lower.right, upper.right);
+    }
+  }
+  return side > 0;
+}
+
+void Polygon::Prepare() {
+  edges_.clear();
+  slab_x_.clear();
+  slab_starts_.clear();
+  slab_edges_.clear();
+  column_starts_.clear();
+  column_spans_.clear();
+
+  struct ColumnSpan {
+    int64_t xcord;
+    int64_t low;
+    int64_t high;
+  };
+  std::vector<ColumnSpan> spans;
+  spans.reserve(vertices_.size());
+  ForEachEdge([&](const Vector& first, const Vector& second) {
+    spans.push_back(ColumnSpan{first.GetX(), first.GetY(), first.GetY()});
+    if (first.GetX() == second.GetX()) {
+      spans.push_back(ColumnSpan{first.GetX(),
+                                 std::min(first.GetY(), second.GetY()),
+                                 std::max(first.GetY(), second.GetY())});
+    } else if (first.GetX() < second.GetX()) {
+      edges_.push_back(Edge{first, second});
+    } else {
+      edges_.push_back(Edge{second, first});
+    }
+    return false;
+  });
+  if (edges_.size() > std::numeric_limits<uint32_t>::max()) {
+    throw std::length_error("Polygon::Prepare: too many edges");
+  }
+
+  std::sort(spans.begin(), spans.end(),
+            [](const ColumnSpan& a, const ColumnSpan& b) {
+              return a.xcord != b.xcord ? a.xcord < b.xcord : a.low < b.low;
+            });
+  for (const ColumnSpan& span : spans) {
+    if (slab_x_.empty() || slab_x_.back() != span.xcord) {
+      slab_x_.push_back(span.xcord);
+      column_starts_.push_back(column_spans_.size());
+      column_spans_.emplace_back(span.low, span.high);
+    } else if (span.low <= column_spans_.back().second) {
+      column_spans_.back().second =
+          std::max(column_spans_.back().second, span.high);
+    } else {
+      column_spans_.emplace_back(span.low, span.high);
+    }
+  }
+  column_starts_.push_back(column_spans_.size());
+
+  // Sweep the slabs left to right. Edges keep their order from one slab to
+  // the next, so only the ones starting at a slab are placed.
+  std::vector<uint32_t> order(edges_.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+    return edges_[a].left.GetX() < edges_[b].left.GetX();
+  });
+  auto below = [this](uint32_t lower, uint32_t upper) {
+    return EdgeBelow(edges_[lower], edges_[upper]);
+  };
+  std::vector<uint32_t> active;
+  size_t next = 0;
+  slab_starts_.push_back(0);
+  for (size_t slab = 0; slab + 1 < slab_x_.size(); ++slab) {
+    int64_t left_x = slab_x_[slab];
+    active.erase(std::remove_if(active.begin(), active.end(),
+                                [this, left_x](uint32_t id) {
+                                  return edges_[id].right.GetX() <= left_x;
+                                }),
+                 active.end());
+    for (; next < order.size() && edges_[order[next]].left.GetX() == left_x;
+         ++next) {
+      active.insert(
+          std::upper_bound(active.begin(), active.end(), order[next], below),
+          order[next]);
+    }
+    slab_edges_.insert(slab_edges_.end(), active.begin(), active.end());
+    slab_starts_.push_back(slab_edges_.size());
+  }
+}
+
+bool Polygon::OnColumn(size_t column, int64_t ycord) const {
+  auto first = column_spans_.begin() + column_starts_[column];
+  auto last = column_spans_.begin() + column_starts_[column + 1];
+  auto after = std::partition_point(
+      first, last, [ycord](const std::pair<int64_t, int64_t>& span) {
+        return span.first <= ycord;
+      });
+  return after != first && ycord <= std::prev(after)->second;
+}
+
+bool Polygon::PreparedContains(const Vector& point) const {
+  auto column = std::upper_bound(slab_x_.begin(), slab_x_.end(), point.GetX());
+  if (column == slab_x_.begin()) {
+    return false;
+  }
+  size_t slab = std::prev(column) - slab_x_.begin();
+  if (slab_x_[slab] == point.GetX() && OnColumn(slab, point.GetY())) {
+    return true;
+  }
+  if (slab + 1 == slab_x_.size()) {
+    return false;
+  }
+  const uint32_t* first = slab_edges_.data() + slab_starts_[slab];
+  const uint32_t* last = slab_edges_.data() + slab_starts_[slab + 1];
+  auto side = [this, &point](uint32_t id) {
+    return Orientation(edges_[id].left, edges_[id].right, point);
+  };
+  const uint32_t* above = std::partition_point(
+      first, last, [&side](uint32_t id) { return side(id) > 0; });
+  if (above != last && side(*above) == 0) {
+    return true;
+  }
+  return (last - above) % 2 == 1;
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "geometry.hpp"
+
+// Polygon given by an outer ring and optional holes, each ring closed
+// implicitly and in either orientation. The rings must be simple and must
+// not cross each other; this is not checked. A point is contained if it is
+// inside by the even-odd rule or on the boundary. CrossSegment tests the
+// segment against the boundary, as Circle does.
+//
+// ContainsPoint walks every edge. Prepare() builds a slab decomposition
+// instead: the distinct vertex x-coordinates cut the plane into vertical
+// slabs, and the edges spanning each slab are stored bottom to top, so a
+// query is two binary searches. It takes O(n * k) memory, k being the most
+// edges a vertical line crosses (O(n^2) at worst). Move keeps it valid.
+class Polygon : public IShape {
+ public:
+  explicit Polygon(const std::vector<Point>& outer,
+                   const std::vector<std::vector<Point>>& holes = {});
+
+  ShapeKind GetKind() const override { return ShapeKind::kPolygon; }
+
+  size_t RingCount() const { return ring_ends_.size(); }
+
+  // Ring 0 is the outer one.
+  std::vector<Point> GetRing(size_t index) const;
+
+  void Move(const Vector& vector) override;
+
+  bool ContainsPoint(const Point& point) const override;
+
+  bool CrossSegment(const Segment& segment) const override;
+
+  BoundingBox GetBoundingBox() const override { return box_; }
+
+  IShape* Clone() const override { return new Polygon(*this); }
+
+  // The vertex and slab arrays of the copy stay on the heap.
+  IShape* CloneInto(ShapeArena& arena) const override {
+    return arena.Create<Polygon>(*this);
+  }
+
+  void Prepare();
+
+  bool IsPrepared() const { return !slab_x_.empty(); }
+
+  // func(first, second) for every edge, its ends as Vectors, until it
+  // returns true; returns whether one did.
+  template <typename Func>
+  bool ForEachEdge(Func func) const {
+    size_t begin = 0;
+    for (size_t end : ring_ends_) {
+      for (size_t i = begin; i < end; ++i) {
+        if (func(vertices_[i], vertices_[i + 1 == end ? begin : i + 1])) {
+          return true;
+        }
+      }
+      begin = end;
+    }
+    return false;
+  }
+
+ private:
+  // A non-vertical edge, left endpoint first.
+  struct Edge {
+    Vector left;
+    Vector right;
+  };
+
+  static bool EdgeBelow(const Edge& lower, const Edge& upper);
+
+  void AddRing(const std::vector<Point>& ring);
+
+  bool OnColumn(size_t column, int64_t ycord) const;
+
+  bool PreparedContains(const Vector& point) const;
+
+  std::vector<Vector> vertices_;
+  std::vector<size_t> ring_ends_;
+  BoundingBox box_;
+
+  // The slab decomposition. slab_x_ holds the distinct vertex x; slab i
+  // lies between slab_x_[i] and slab_x_[i + 1] and owns
+  // slab_edges_[slab_starts_[i], slab_starts_[i + 1]). Column i is the
+  // line x = slab_x_[i], with the vertices and vertical edges on it merged
+  // into disjoint y-spans.
+  std::vector<Edge> edges_;
+  std::vector<int64_t> slab_x_;
+  std::vector<size_t> slab_starts_;
+  std::vector<uint32_t> slab_edges_;
+  std::vector<size_t> column_starts_;
+  std::vector<std::pair<int64_t, int64_t>> column_spans_;
+};
@@ -0,0 +1,222 @@
+#pragma once
+#include "geometry.hpp"
+
+// Shapes with their derived data computed once, for testing one shape
+// against many queries: direction vectors, bounding boxes and the squared
+// radius. Each answers exactly as the shape it was built from, by the same
+// sign tests. They are plain values, not IShapes, and do not follow later
+// changes to that shape.
+
+template <typename Coord>
+class BasicPreparedSegment {
+ private:
+  using Vector = BasicVector<Coord>;
+  using Point = BasicPoint<Coord>;
+  using Segment = BasicSegment<Coord>;
+  using BoundingBox = BasicBoundingBox<Coord>;
+
+  Vector begin_;
+  Vector end_;
+  Vector direct_;
+  BoundingBox box_;
+
+ public:
+  constexpr explicit BasicPreparedSegment(const Segment& segment)
+      : begin_(segment.GetA()),
+        end_(segment.GetB()),
+        direct_(end_ - begin_),
+        box_(segment.GetBoundingBox()) {}
+
+  constexpr BoundingBox GetBoundingBox() const { return box_; }
+
+  constexpr bool ContainsPoint(const Point& point) const {
+    if (CoordTraits<Coord>::kExact &&
+        !box_.Contains(point.GetX(), point.GetY())) {
+      return false;
+    }
+    if (direct_ == -direct_) {
+      return point.ContainsPoint(Point(begin_));
+    }
+    Vector from_begin = Vector(point) - begin_;
+    return CrossSign(from_begin, direct_) == 0 &&
+           DotSign(from_begin, direct_) >= 0 &&
+           DotSign(Vector(point) - end_, -direct_) >= 0;
+  }
+
+  constexpr bool CrossSegment(const Segment& segment) const {
+    if (CoordTraits<Coord>::kExact &&
+        !box_.Overlaps(segment.GetBoundingBox())) {
+      return false;
+    }
+    Vector c_p(segment.GetA());
+    Vector d_p(segment.GetB());
+    Vector cd_vect = d_p - c_p;
+    if (CrossSign(direct_, cd_vect) != 0) {
+      int expr1 = CrossSign(direct_, c_p - begin_) *
+                  CrossSign(direct_, d_p - begin_);
+      int expr2 = CrossSign(cd_vect, begin_ - c_p) *
+                  CrossSign(cd_vect, end_ - c_p);
+      return expr1 <= 0 && expr2 <= 0;
+    }
+    if (ContainsPoint(Point(c_p)) || ContainsPoint(Point(d_p))) {
+      return true;
+    }
+    return segment.ContainsPoint(Point(begin_)) ||
+           segment.ContainsPoint(Point(end_));
+  }
+};
+
+template <typename Coord>
+class BasicPreparedLine {
+ private:
+  using Vector = BasicVector<Coord>;
+  using Point = BasicPoint<Coord>;
+  using Segment = BasicSegment<Coord>;
+  using Line = BasicLine<Coord>;
+  using BoundingBox = BasicBoundingBox<Coord>;
+
+  Vector first_;
+  Vector direct_;
+  BoundingBox box_;
+
+ public:
+  constexpr explicit BasicPreparedLine(const Line& line)
+      : first_(line.GetFirst()),
+        direct_(Vector(line.GetSecond()) - first_),
+        box_(line.GetBoundingBox()) {}
+
+  constexpr BoundingBox GetBoundingBox() const { return box_; }
+
+  constexpr bool ContainsPoint(const Point& point) const {
+    return CrossSign(Vector(point) - first_, direct_) == 0;
+  }
+
+  constexpr bool CrossSegment(const Segment& segment) const {
+    return CrossSign(direct_, Vector(segment.GetA()) - first_) *
+               CrossSign(direct_, Vector(segment.GetB()) - first_) <=
+           0;
+  }
+};
+
+template <typename Coord>
+class BasicPreparedRay {
+ private:
+  using Vector = BasicVector<Coord>;
+  using Point = BasicPoint<Coord>;
+  using Segment = BasicSegment<Coord>;
+  using Ray = BasicRay<Coord>;
+  using BoundingBox = BasicBoundingBox<Coord>;
+
+  Vector first_;
+  Vector direct_;
+  BoundingBox box_;
+
+ public:
+  constexpr explicit BasicPreparedRay(const Ray& ray)
+      : first_(ray.GetA()),
+        direct_(ray.GetVector()),
+        box_(ray.GetBoundingBox()) {}
+
+  constexpr BoundingBox GetBoundingBox() const { return box_; }
+
+  constexpr bool ContainsPoint(const Point& point) const {
+    if (CoordTraits<Coord>::kExact &&
+        !box_.Contains(point.GetX(), point.GetY())) {
+      return false;
+    }
+    Vector from_first = Vector(point) - first_;
+    return CrossSign(from_first, direct_) == 0 &&
+           DotSign(from_first, direct_) >= 0;
+  }
+
+  // The same steps as Ray::CrossSegment, with the segment's line normal
+  // computed directly instead of through a Line.
+  constexpr bool CrossSegment(const Segment& segment) const {
+    if (CoordTraits<Coord>::kExact &&
+        !box_.Overlaps(segment.GetBoundingBox())) {
+      return false;
+    }
+    Point a_p = segment.GetA();
+    Point b_p = segment.GetB();
+    if (ContainsPoint(a_p) || ContainsPoint(b_p)) {
+      return true;
+    }
+    Vector start_to_seg = Vector(a_p) - first_;
+    if (CrossSign(direct_, start_to_seg) *
+            CrossSign(direct_, Vector(b_p) - first_) >
+        0) {
+      return false;
+    }
+    Vector along = Vector(b_p) - Vector(a_p);
+    Vector seg_normal(along.GetY(), -along.GetX());
+    int ray_to_norm = DotSign(direct_, seg_normal);
+    return ray_to_norm != 0 &&
+           DotSign(start_to_seg, seg_normal) * ray_to_norm >= 0;
+  }
+};
+
+template <typename Coord>
+class BasicPreparedCircle {
+ private:
+  using Vector = BasicVector<Coord>;
+  using Point = BasicPoint<Coord>;
+  using Segment = BasicSegment<Coord>;
+  using Circle = BasicCircle<Coord>;
+  using BoundingBox = BasicBoundingBox<Coord>;
+  using Square = typename CoordTraits<Coord>::Square;
+
+  Vector centre_;
+  Square radius_squared_;
+  BoundingBox box_;
+
+ public:
+  constexpr explicit BasicPreparedCircle(const Circle& circle)
+      : centre_(circle.GetCentre()),
+        radius_squared_(circle.RadiusSquared()),
+        box_(circle.GetBoundingBox()) {}
+
+  constexpr BoundingBox GetBoundingBox() const { return box_; }
+
+  constexpr bool ContainsPoint(const Point& point) const {
+    if (CoordTraits<Coord>::kExact &&
+        !box_.Contains(point.GetX(), point.GetY())) {
+      return false;
+    }
+    return CompareValues<Coord>(SquaredLength(Vector(point) - centre_),
+                                radius_squared_) <= 0;
+  }
+
+  constexpr bool PointInCircle(const Point& point) const {
+    return CompareValues<Coord>(SquaredLength(Vector(point) - centre_),
+                                radius_squared_) < 0;
+  }
+
+  constexpr bool CrossSegment(const Segment& segment) const {
+    if (CoordTraits<Coord>::kExact &&
+        !box_.Overlaps(segment.GetBoundingBox())) {
+      return false;
+    }
+    Point a_p = segment.GetA();
+    Point b_p = segment.GetB();
+    if (PointInCircle(a_p) && PointInCircle(b_p)) {
+      return false;
+    }
+    Vector ab_vect = Vector(b_p) - Vector(a_p);
+    Vector ac_vect = centre_ - Vector(a_p);
+    Vector bc_vect = centre_ - Vector(b_p);
+    Square area_abs = AbsWide<Coord>(WideCross(ac_vect, bc_vect));
+    if (CompareSquareProducts<Coord>(area_abs, area_abs, radius_squared_,
+                                     SquaredLength(ab_vect)) > 0) {
+      return false;
+    }
+    if (ContainsPoint(a_p) || ContainsPoint(b_p)) {
+      return true;
+    }
+    return DotSign(-ab_vect, bc_vect) > 0 && DotSign(ab_vect, ac_vect) > 0;
+  }
+};
+
+using PreparedSegment = BasicPreparedSegment<int64_t>;
+using PreparedLine = BasicPreparedLine<int64_t>;
+using PreparedRay = BasicPreparedRay<int64_t>;
+using PreparedCircle = BasicPreparedCircle<int64_t>;
@@ -0,0 +1,256 @@
+#include "ray_cast.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+// The floating-point ray parameters of a box side are within a relative
+// 2^-50 of the exact ones: the differences are exact int64_t values and
+// only conversions and the division round.
+const double kSlack = 1e-14;
+
+struct RayState {
+  Vector origin;
+  Vector direct;
+  double dx;
+  double dy;
+  double limit;
+};
+
+// Conservative slab test: false only if the ray misses 'box' or enters it
+// beyond 'limit'.
+bool MayHit(const BoundingBox& box, const RayState& ray) {
+  double near = 0;
+  double far = ray.limit;
+  auto clip = [&](int64_t low, int64_t high, int64_t origin, int64_t direct,
+                  double step) {
+    if (direct == 0) {
+      return low <= origin && origin <= high;
+    }
+    double first = static_cast<double>(low - origin) / step;
+    double second = static_cast<double>(high - origin) / step;
+    if (first > second) {
+      std::swap(first, second);
+    }
+    near = std::max(near, first - std::abs(first) * kSlack);
+    far = std::min(far, second + std::abs(second) * kSlack);
+    return near <= far;
+  };
+  return clip(box.min_x, box.max_x, ray.origin.GetX(), ray.direct.GetX(),
+              ray.dx) &&
+         clip(box.min_y, box.max_y, ray.origin.GetY(), ray.direct.GetY(),
+              ray.dy);
+}
+
+// Ray::CrossSegment for a non-degenerate ray, also giving the smallest t
+// at which the ray meets the segment.
+bool HitParameter(const Vector& origin, const Vector& direct,
+                  const Vector& begin, const Vector& end,
+                  unsigned __int128& numerator,
+                  unsigned __int128& denominator) {
+  // origin + t * direct = begin + u * along, solved by Cramer's rule.
+  Vector along = end - begin;
+  Vector start = begin - origin;
+  __int128 det = WideCross(direct, along);
+  if (det != 0) {
+    __int128 t_num = WideCross(start, along);
+    __int128 u_num = WideCross(start, direct);
+    if (det < 0) {
+      det = -det;
+      t_num = -t_num;
+      u_num = -u_num;
+    }
+    if (t_num < 0 || u_num < 0 || u_num > det) {
+      return false;
+    }
+    numerator = static_cast<unsigned __int128>(t_num);
+    denominator = static_cast<unsigned __int128>(det);
+    return true;
+  }
+  // Parallel, or a single point: only a part on the ray's line can be hit.
+  if (WideCross(start, direct) != 0) {
+    return false;
+  }
+  __int128 begin_t = WideDot(start, direct);
+  __int128 end_t = WideDot(end - origin, direct);
+  if (std::max(begin_t, end_t) < 0) {
+    return false;
+  }
+  numerator = static_cast<unsigned __int128>(
+      std::max<__int128>(std::min(begin_t, end_t), 0));
+  denominator = SquaredLength(direct);
+  return true;
+}
+
+bool Closer(unsigned __int128 numerator, unsigned __int128 denominator,
+            size_t segment, const RayHit& best) {
+  if (!best.IsHit()) {
+    return true;
+  }
+  int order =
+      CompareProducts(numerator, best.denominator, best.numerator, denominator);
+  return order < 0 || (order == 0 && segment < best.segment);
+}
+
+}  // namespace
+
+SegmentBvh::SegmentBvh(const std::vector<Segment>& segments) {
+  if (segments.size() > std::numeric_limits<uint32_t>::max()) {
+    throw std::length_error("SegmentBvh: too many segments");
+  }
+  std::vector<Item> items;
+  items.reserve(segments.size());
+  for (size_t id = 0; id < segments.size(); ++id) {
+    items.push_back(
+        Item{segments[id].GetBoundingBox(), static_cast<uint32_t>(id)});
+  }
+  if (!items.empty()) {
+    Build(items, 0, items.size());
+  }
+  ids_.reserve(items.size());
+  begins_.reserve(items.size());
+  ends_.reserve(items.size());
+  for (const Item& item : items) {
+    ids_.push_back(item.id);
+    begins_.emplace_back(segments[item.id].GetA());
+    ends_.emplace_back(segments[item.id].GetB());
+  }
+}
+
+// Median split of the box centres along their wider extent.
+void SegmentBvh::Build(std::vector<Item>& items, size_t begin, size_t end) {
+  size_t index = nodes_.size();
+  nodes_.emplace_back();
+  BoundingBox box = items[begin].box;
+  int64_t centre_min[2] = {BoundingBox::kMax, BoundingBox::kMax};
+  int64_t centre_max[2] = {BoundingBox::kMin, BoundingBox::kMin};
+  for (size_t i = begin; i < end; ++i) {
+    const BoundingBox& item = items[i].box;
+    box.min_x = std::min(box.min_x, item.min_x);
+    box.min_y = std::min(box.min_y, item.min_y);
+    box.max_x = std::max(box.max_x, item.max_x);
+    box.max_y = std::max(box.max_y, item.max_y);
+    int64_t centre[2] = {item.min_x + item.max_x, item.min_y + item.max_y};
+    for (int axis = 0; axis < 2; ++axis) {
+      centre_min[axis] = std::min(centre_min[axis], centre[axis]);
+      centre_max[axis] = std::max(centre_max[axis], centre[axis]);
+    }
+  }
+  nodes_[index].box = box;
+  if (end - begin <= kLeafSize) {
+    nodes_[index].first = static_cast<uint32_t>(begin);
+    nodes_[index].count = static_cast<uint32_t>(end - begin);
+    return;
+  }
+  uint8_t axis = static_cast<uint64_t>(centre_max[1]) - centre_min[1] >
+                         static_cast<uint64_t>(centre_max[0]) - centre_min[0]
+                     ? 1
+                     : 0;
+  size_t middle = begin + (end - begin) / 2;
+  std::nth_element(items.begin() + begin, items.begin() + middle,
+                   items.begin() + end,
+                   [axis](const Item& left, const Item& right) {
+                     return axis == 0 ? left.box.min_x + left.box.max_x <
+                                            right.box.min_x + right.box.max_x
+                                      : left.box.min_y + left.box.max_y <
+                                            right.box.min_y + right.box.max_y;
+                   });
+  nodes_[index].axis = axis;
+  Build(items, begin, middle);
+  nodes_[index].right = static_cast<uint32_t>(nodes_.size());
+  Build(items, middle, end);
+}
+
+RayHit SegmentBvh::FirstHit(const Ray& ray) const {
+  RayHit hit;
+  TracePacket(&ray, 1, &hit);
+  return hit;
+}
+
+void SegmentBvh::FirstHits(const Ray* rays, size_t count, RayHit* out) const {
+  for (size_t begin = 0; begin < count; begin += kPacketSize) {
+    TracePacket(rays + begin, std::min(kPacketSize, count - begin),
+                out + begin);
+  }
+}
+
+void SegmentBvh::TracePacket(const Ray* rays, size_t count,
+                             RayHit* out) const {
+  RayState states[kPacketSize];
+  uint32_t live = 0;
+  for (size_t i = 0; i < count; ++i) {
+    out[i] = RayHit();
+    Vector origin(rays[i].GetA());
+    Vector direct = rays[i].GetVector();
+    if (direct == Vector()) {
+      if (!ids_.empty()) {
+        out[i].segment = 0;
+      }
+      continue;
+    }
+    states[i] = RayState{origin,
+                         direct,
+                         static_cast<double>(direct.GetX()),
+                         static_cast<double>(direct.GetY()),
+                         std::numeric_limits<double>::infinity()};
+    live |= 1u << i;
+  }
+  if (live == 0 || nodes_.empty()) {
+    return;
+  }
+
+  // Pending nodes with the rays still to test against them. A median
+  // split keeps the depth, and so the stack, logarithmic.
+  struct Pending {
+    uint32_t node;
+    uint32_t mask;
+  };
+  Pending stack[128];
+  size_t depth = 0;
+  stack[depth++] = Pending{0, live};
+  while (depth != 0) {
+    Pending pending = stack[--depth];
+    const Node& node = nodes_[pending.node];
+    uint32_t mask = 0;
+    for (uint32_t rest = pending.mask; rest != 0; rest &= rest - 1) {
+      int i = __builtin_ctz(rest);
+      if (MayHit(node.box, states[i])) {
+        mask |= 1u << i;
+      }
+    }
+    if (mask == 0) {
+      continue;
+    }
+    if (node.count == 0) {
+      // The nearer child, as seen by the first live ray, goes on top.
+      const RayState& lead = states[__builtin_ctz(mask)];
+      int64_t step = node.axis == 0 ? lead.direct.GetX() : lead.direct.GetY();
+      uint32_t left = pending.node + 1;
+      uint32_t near = step >= 0 ? left : node.right;
+      uint32_t far = step >= 0 ? node.right : left;
+      stack[depth++] = Pending{far, mask};
+      stack[depth++] = Pending{near, mask};
+      continue;
+    }
+    for (uint32_t rest = mask; rest != 0; rest &= rest - 1) {
+      int i = __builtin_ctz(rest);
+      RayState& state = states[i];
+      for (uint32_t slot = node.first; slot < node.first + node.count;
+           ++slot) {
+        unsigned __int128 numerator = 0;
+        unsigned __int128 denominator = 1;
+        if (!HitParameter(state.origin, state.direct, begins_[slot],
+                          ends_[slot], numerator, denominator) ||
+            !Closer(numerator, denominator, ids_[slot], out[i])) {
+          continue;
+        }
+        out[i].segment = ids_[slot];
+        out[i].numerator = numerator;
+        out[i].denominator = denominator;
+        state.limit = out[i].Parameter() * (1 + kSlack);
+      }
+    }
+  }
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "geometry.hpp"
+
+// Where a ray first meets a segment set: the segment's index and the ray
+// parameter t = numerator / denominator, the hit point being
+// origin + t * direction.
+struct RayHit {
+  static const size_t kNone = std::numeric_limits<size_t>::max();
+
+  size_t segment = kNone;
+  unsigned __int128 numerator = 0;
+  unsigned __int128 denominator = 1;
+
+  bool IsHit() const { return segment != kNone; }
+
+  double Parameter() const {
+    return static_cast<double>(numerator) / static_cast<double>(denominator);
+  }
+};
+
+// Bounding volume hierarchy over a fixed set of segments for first-hit ray
+// casting. A ray hits exactly the segments Ray::CrossSegment accepts; the
+// first hit is the one with the smallest t, compared exactly, ties going
+// to the smallest index. A collinear segment is hit where the ray first
+// touches it, and a degenerate ray, containing every point, hits segment 0
+// at t = 0. Boxes are tested in floating point with enough slack never to
+// reject a box holding a hit. Exact for coordinates below 2^62.
+class SegmentBvh {
+ public:
+  explicit SegmentBvh(const std::vector<Segment>& segments);
+
+  size_t Size() const { return ids_.size(); }
+
+  RayHit FirstHit(const Ray& ray) const;
+
+  // Rays are traced kPacketSize at a time, each packet walking the
+  // hierarchy once. out must hold 'count' hits.
+  void FirstHits(const Ray* rays, size_t count, RayHit* out) const;
+
+  static const size_t kPacketSize = 8;
+
+ private:
+  // Internal nodes have count == 0, the left child right after them and
+  // the right one at 'right'. Leaves hold ids_[first, first + count).
+  struct Node {
+    BoundingBox box;
+    uint32_t first = 0;
+    uint32_t count = 0;
+    uint32_t right = 0;
+    uint8_t axis = 0;
+  };
+
+  struct Item {
+    BoundingBox box;
+    uint32_t id;
+  };
+
+  static const size_t kLeafSize = 4;
+
+  void Build(std::vector<Item>& items, size_t begin, size_t end);
+
+  void TracePacket(const Ray* rays, size_t count, RayHit* out) const;
+
+  std::vector<Node> nodes_;
+  std::vector<uint32_t> ids_;
+  std::vector<Vector> begins_;
+  std::vector<Vector> ends_;
+};
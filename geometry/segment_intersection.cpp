@@ -0,0 +1,274 @@
+#include "segment_intersection.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <queue>
+#include <set>
+
+namespace {
+
+// Endpoints in lexicographic order, so a vertical segment runs upwards.
+struct SweepSegment {
+  Point left;
+  Point right;
+};
+
+SweepSegment Oriented(const Segment& segment) {
+  Point begin = segment.GetA();
+  Point end = segment.GetB();
+  bool ordered = begin.GetX() < end.GetX() ||
+                 (begin.GetX() == end.GetX() && begin.GetY() <= end.GetY());
+  return ordered ? SweepSegment{begin, end} : SweepSegment{end, begin};
+}
+
+int Orientation(const Point& first, const Point& second, const Point& point) {
+  return CrossSign(Vector(second - first), Vector(point - first));
+}
+
+// Orders segments crossing the sweep line by their height at the larger of
+// the two left x: there one of them starts, and its left endpoint is tested
+// against the other. Consistent as long as no two of the set intersect;
+// equivalent segments touch.
+class BelowAtSweep {
+ public:
+  explicit BelowAtSweep(const std::vector<SweepSegment>& segments)
+      : segments_(segments) {}
+
+  bool operator()(size_t left_id, size_t right_id) const {
+    const SweepSegment& left = segments_[left_id];
+    const SweepSegment& right = segments_[right_id];
+    if (left.left.GetX() <= right.left.GetX()) {
+      return IsBelow(left, right.left);
+    }
+    return IsAbove(right, left.left);
+  }
+
+ private:
+  // Whether 'segment' passes below 'point', which lies within its x-extent.
+  static bool IsBelow(const SweepSegment& segment, const Point& point) {
+    if (segment.left.GetX() == segment.right.GetX()) {
+      return segment.left.GetY() < point.GetY();
+    }
+    return Orientation(segment.left, segment.right, point) > 0;
+  }
+
+  static bool IsAbove(const SweepSegment& segment, const Point& point) {
+    if (segment.left.GetX() == segment.right.GetX()) {
+      return point.GetY() < segment.left.GetY();
+    }
+    return Orientation(segment.left, segment.right, point) < 0;
+  }
+
+  const std::vector<SweepSegment>& segments_;
+};
+
+std::pair<size_t, size_t> Ordered(size_t first, size_t second) {
+  return std::make_pair(std::min(first, second), std::max(first, second));
+}
+
+// Segment tree over compressed y with each active interval stored in its
+// canonical nodes, for stabbing queries in O(log N + output).
+class StabbingTree {
+ public:
+  explicit StabbingTree(size_t leaves, size_t ids)
+      : leaves_(leaves), nodes_(2 * leaves), slots_(ids) {}
+
+  void Insert(size_t id, size_t low, size_t high) {
+    for (low += leaves_, high += leaves_ + 1; low < high;
+         low >>= 1, high >>= 1) {
+      if (low & 1) {
+        Attach(id, low++);
+      }
+      if (high & 1) {
+        Attach(id, --high);
+      }
+    }
+  }
+
+  void Remove(size_t id) {
+    for (const Slot& slot : slots_[id]) {
+      std::vector<Entry>& node = nodes_[slot.node];
+      Entry moved = node.back();
+      node[slot.position] = moved;
+      slots_[moved.id][moved.slot].position = slot.position;
+      node.pop_back();
+    }
+    slots_[id].clear();
+  }
+
+  // Reports every stored interval containing leaf 'point'.
+  template <typename Report>
+  void Stab(size_t point, Report report) const {
+    for (size_t node = point + leaves_; node != 0; node >>= 1) {
+      for (const Entry& entry : nodes_[node]) {
+        report(entry.id);
+      }
+    }
+  }
+
+ private:
+  struct Entry {
+    size_t id;
+    size_t slot;
+  };
+
+  struct Slot {
+    size_t node;
+    size_t position;
+  };
+
+  void Attach(size_t id, size_t node) {
+    nodes_[node].push_back(Entry{id, slots_[id].size()});
+    slots_[id].push_back(Slot{node, nodes_[node].size() - 1});
+  }
+
+  size_t leaves_;
+  std::vector<std::vector<Entry>> nodes_;
+  std::vector<std::vector<Slot>> slots_;
+};
+
+}  // namespace
+
+bool AnyIntersection(const std::vector<Segment>& segments,
+                     std::pair<size_t, size_t>* witness) {
+  std::vector<SweepSegment> sweep;
+  sweep.reserve(segments.size());
+  for (const Segment& segment : segments) {
+    sweep.push_back(Oriented(segment));
+  }
+  // Insertions come before removals at the same x, so segments touching
+  // at an endpoint are neighbours at some point.
+  struct Event {
+    int64_t xcord;
+    int removal;
+    int64_t ycord;
+    size_t id;
+  };
+  std::vector<Event> events;
+  events.reserve(2 * segments.size());
+  for (size_t id = 0; id < sweep.size(); ++id) {
+    events.push_back(
+        Event{sweep[id].left.GetX(), 0, sweep[id].left.GetY(), id});
+    events.push_back(
+        Event{sweep[id].right.GetX(), 1, sweep[id].right.GetY(), id});
+  }
+  std::sort(events.begin(), events.end(), [](const Event& a, const Event& b) {
+    if (a.xcord != b.xcord) {
+      return a.xcord < b.xcord;
+    }
+    if (a.removal != b.removal) {
+      return a.removal < b.removal;
+    }
+    return a.ycord < b.ycord;
+  });
+
+  auto found = [&](size_t first, size_t second) {
+    if (!segments[first].CrossSegment(segments[second])) {
+      return false;
+    }
+    if (witness != nullptr) {
+      *witness = Ordered(first, second);
+    }
+    return true;
+  };
+  using Status = std::set<size_t, BelowAtSweep>;
+  Status status{BelowAtSweep(sweep)};
+  std::vector<Status::iterator> where(sweep.size(), status.end());
+  for (const Event& event : events) {
+    if (event.removal == 0) {
+      auto [position, inserted] = status.insert(event.id);
+      if (!inserted) {
+        // An equivalent segment: the new left endpoint lies on it.
+        if (found(*position, event.id)) {
+          return true;
+        }
+        continue;
+      }
+      where[event.id] = position;
+      auto next = std::next(position);
+      if (next != status.end() && found(*next, event.id)) {
+        return true;
+      }
+      if (position != status.begin() &&
+          found(*std::prev(position), event.id)) {
+        return true;
+      }
+    } else {
+      auto position = where[event.id];
+      if (position == status.end()) {
+        continue;
+      }
+      auto next = std::next(position);
+      if (next != status.end() && position != status.begin() &&
+          found(*std::prev(position), *next)) {
+        return true;
+      }
+      status.erase(position);
+    }
+  }
+  return false;
+}
+
+std::vector<std::pair<size_t, size_t>> FindIntersectingPairs(
+    const std::vector<Segment>& segments) {
+  std::vector<BoundingBox> boxes;
+  boxes.reserve(segments.size());
+  std::vector<int64_t> ys;
+  ys.reserve(2 * segments.size());
+  for (const Segment& segment : segments) {
+    boxes.push_back(segment.GetBoundingBox());
+    ys.push_back(boxes.back().min_y);
+    ys.push_back(boxes.back().max_y);
+  }
+  std::sort(ys.begin(), ys.end());
+  ys.erase(std::unique(ys.begin(), ys.end()), ys.end());
+  auto rank = [&ys](int64_t ycord) {
+    return static_cast<size_t>(std::lower_bound(ys.begin(), ys.end(), ycord) -
+                               ys.begin());
+  };
+
+  std::vector<size_t> order(segments.size());
+  for (size_t id = 0; id < order.size(); ++id) {
+    order[id] = id;
+  }
+  std::sort(order.begin(), order.end(), [&boxes](size_t a, size_t b) {
+    return boxes[a].min_x < boxes[b].min_x;
+  });
+
+  // Active segments: a stabbing tree answers "spans min_y", a map by
+  // min_y answers "starts within (min_y, max_y]". Together they give every
+  // active box overlapping the new one in y, each exactly once.
+  StabbingTree spans(std::max<size_t>(ys.size(), 1), segments.size());
+  std::multimap<int64_t, size_t> starts;
+  std::vector<std::multimap<int64_t, size_t>::iterator> where(segments.size());
+  using Expiry = std::pair<int64_t, size_t>;
+  std::priority_queue<Expiry, std::vector<Expiry>, std::greater<Expiry>>
+      expiring;
+
+  std::vector<std::pair<size_t, size_t>> pairs;
+  auto test = [&](size_t active, size_t id) {
+    if (segments[active].CrossSegment(segments[id])) {
+      pairs.push_back(Ordered(active, id));
+    }
+  };
+  for (size_t id : order) {
+    const BoundingBox& box = boxes[id];
+    while (!expiring.empty() && expiring.top().first < box.min_x) {
+      size_t done = expiring.top().second;
+      expiring.pop();
+      spans.Remove(done);
+      starts.erase(where[done]);
+    }
+    spans.Stab(rank(box.min_y), [&](size_t active) { test(active, id); });
+    for (auto it = starts.upper_bound(box.min_y);
+         it != starts.end() && it->first <= box.max_y; ++it) {
+      test(it->second, id);
+    }
+    spans.Insert(id, rank(box.min_y), rank(box.max_y));
+    where[id] = starts.emplace(box.min_y, id);
+    expiring.emplace(box.max_x, id);
+  }
+  std::sort(pairs.begin(), pairs.end());
+  return pairs;
+}
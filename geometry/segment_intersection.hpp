@@ -0,0 +1,22 @@
+#pragma once
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "geometry.hpp"
+
+// Intersection tests over a whole set of segments. Both agree exactly with
+// Segment::CrossSegment, touching and collinear overlaps included: it is the
+// final test applied to every pair either of them reports.
+
+// Shamos-Hoey sweep, O(N log N). On success stores one intersecting pair
+// (smaller index first) into 'witness' if it is not null.
+bool AnyIntersection(const std::vector<Segment>& segments,
+                     std::pair<size_t, size_t>* witness = nullptr);
+
+// Every intersecting pair (i, j), i < j, sorted. A sweep over x keeps the
+// segments spanning the sweep line in an interval structure over y, so
+// only pairs with overlapping bounding boxes reach the exact test:
+// O(N log N + B), B being the number of such pairs.
+std::vector<std::pair<size_t, size_t>> FindIntersectingPairs(
+    const std::vector<Segment>& segments);
@@ -0,0 +1,153 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Types whose destructor does nothing although the language does not call
+// it trivial (a virtual destructor never is) can specialize this to true,
+// so the arena neither records nor runs it.
+template <typename T>
+constexpr bool kArenaSkipsDestructor = std::is_trivially_destructible_v<T>;
+
+// Bump allocator for shape copies. Objects are packed into large blocks,
+// each twice the size of the one before, and are all freed at once by
+// Clear or the destructor. Only objects with a destructor that does
+// something are recorded, to be destroyed in reverse order of completion:
+// an object whose constructor creates others in the arena goes first.
+// Pointers into the arena stay valid until then. Clear keeps the blocks,
+// so refilling the arena to the same size allocates nothing; Release
+// returns them. Not thread-safe.
+class ShapeArena {
+ public:
+  // 'initial_bytes' sizes the first block.
+  explicit ShapeArena(size_t initial_bytes = 64 * 1024)
+      : initial_bytes_(std::max<size_t>(initial_bytes, 64)) {}
+
+  ShapeArena(const ShapeArena&) = delete;
+
+  ShapeArena& operator=(const ShapeArena&) = delete;
+
+  ~ShapeArena() { Clear(); }
+
+  template <typename T, typename... Args>
+  T* Create(Args&&... args) {
+    void* place = Allocate(sizeof(T), alignof(T));
+    if constexpr (kArenaSkipsDestructor<T>) {
+      ++objects_;
+      return new (place) T(std::forward<Args>(args)...);
+    } else {
+      // Recorded first, so a failed push_back cannot leave an object that
+      // is never destroyed. The constructor may append entries of its own,
+      // so the slot is kept by index.
+      finalizers_.push_back(
+          Finalizer{nullptr, [](void* ptr) { static_cast<T*>(ptr)->~T(); }});
+      size_t slot = finalizers_.size() - 1;
+      try {
+        T* object = new (place) T(std::forward<Args>(args)...);
+        finalizers_[slot].object = object;
+        std::rotate(finalizers_.begin() + slot,
+                    finalizers_.begin() + slot + 1, finalizers_.end());
+        ++objects_;
+        return object;
+      } catch (...) {
+        // Objects the constructor finished creating stay in the arena.
+        finalizers_[slot].object = nullptr;
+        throw;
+      }
+    }
+  }
+
+  // 'alignment' must be a power of two.
+  void* Allocate(size_t bytes, size_t alignment) {
+    if (block_ < blocks_.size()) {
+      std::byte* begin = blocks_[block_].data.get();
+      size_t start = Align(begin + offset_, alignment) - begin;
+      if (start <= blocks_[block_].size &&
+          bytes <= blocks_[block_].size - start) {
+        offset_ = start + bytes;
+        bytes_ += bytes;
+        return begin + start;
+      }
+    }
+    return AllocateSlow(bytes, alignment);
+  }
+
+  // Destroys every object; the blocks are kept for reuse.
+  void Clear() {
+    for (auto finalizer = finalizers_.rbegin();
+         finalizer != finalizers_.rend(); ++finalizer) {
+      if (finalizer->object != nullptr) {
+        finalizer->destroy(finalizer->object);
+      }
+    }
+    finalizers_.clear();
+    block_ = 0;
+    offset_ = 0;
+    objects_ = 0;
+    bytes_ = 0;
+  }
+
+  // Clear, then frees every block.
+  void Release() {
+    Clear();
+    blocks_.clear();
+  }
+
+  size_t ObjectCount() const { return objects_; }
+
+  size_t BytesUsed() const { return bytes_; }
+
+ private:
+  struct Block {
+    std::unique_ptr<std::byte[]> data;
+    size_t size;
+  };
+
+  struct Finalizer {
+    void* object;
+    void (*destroy)(void*);
+  };
+
+  static std::byte* Align(std::byte* ptr, size_t alignment) {
+    uintptr_t address = reinterpret_cast<uintptr_t>(ptr);
+    return ptr + ((alignment - address % alignment) & (alignment - 1));
+  }
+
+  // Moves on to the next block with room, allocating one if none has.
+  // Blocks kept by Clear are reused before new ones are allocated.
+  void* AllocateSlow(size_t bytes, size_t alignment) {
+    for (++block_; block_ < blocks_.size(); ++block_) {
+      std::byte* begin = blocks_[block_].data.get();
+      size_t start = Align(begin, alignment) - begin;
+      if (start <= blocks_[block_].size &&
+          bytes <= blocks_[block_].size - start) {
+        offset_ = start + bytes;
+        bytes_ += bytes;
+        return begin + start;
+      }
+    }
+    size_t size = blocks_.empty() ? initial_bytes_ : 2 * blocks_.back().size;
+    size = std::max(size, bytes + alignment);
+    blocks_.push_back(Block{std::make_unique<std::byte[]>(size), size});
+    block_ = blocks_.size() - 1;
+    std::byte* begin = blocks_[block_].data.get();
+    size_t start = Align(begin, alignment) - begin;
+    offset_ = start + bytes;
+    bytes_ += bytes;
+    return begin + start;
+  }
+
+  size_t initial_bytes_;
+  std::vector<Block> blocks_;
+  // The block being filled and the first free byte in it.
+  size_t block_ = 0;
+  size_t offset_ = 0;
+  std::vector<Finalizer> finalizers_;
+  size_t objects_ = 0;
+  size_t bytes_ = 0;
+};
@@ -0,0 +1,155 @@
+#include "shape_set.hpp"
+
+#include <stdexcept>
+
+ShapeVariant ToVariant(const IShape& shape) {
+  switch (shape.GetKind()) {
+    case ShapeKind::kPoint:
+      return static_cast<const Point&>(shape);
+    case ShapeKind::kSegment:
+      return static_cast<const Segment&>(shape);
+    case ShapeKind::kLine:
+      return static_cast<const Line&>(shape);
+    case ShapeKind::kRay:
+      return static_cast<const Ray&>(shape);
+    case ShapeKind::kCircle:
+      return static_cast<const Circle&>(shape);
+    case ShapeKind::kPolygon:
+      break;
+  }
+  throw std::invalid_argument("ToVariant: shape is not held by value");
+}
+
+ShapeHandle ShapeSet::Add(const ShapeVariant& shape) {
+  return std::visit(
+      [this](const auto& alt) {
+        using Shape = std::decay_t<decltype(alt)>;
+        std::vector<Shape>& bucket = Bucket<Shape>();
+        bucket.push_back(alt);
+        return ShapeHandle{kShapeKind<Shape>, bucket.size() - 1};
+      },
+      shape);
+}
+
+ShapeVariant ShapeSet::Get(ShapeHandle handle) const {
+  switch (handle.kind) {
+    case ShapeKind::kPoint:
+      return Bucket<Point>().at(handle.index);
+    case ShapeKind::kSegment:
+      return Bucket<Segment>().at(handle.index);
+    case ShapeKind::kLine:
+      return Bucket<Line>().at(handle.index);
+    case ShapeKind::kRay:
+      return Bucket<Ray>().at(handle.index);
+    case ShapeKind::kCircle:
+      return Bucket<Circle>().at(handle.index);
+    case ShapeKind::kPolygon:
+      break;
+  }
+  throw std::invalid_argument("ShapeSet::Get: unknown shape kind");
+}
+
+namespace {
+
+template <typename Shape>
+void SwapAndPop(std::vector<Shape>& bucket, size_t index) {
+  if (index >= bucket.size()) {
+    throw std::out_of_range("ShapeSet::Remove: no such shape");
+  }
+  if (index + 1 != bucket.size()) {
+    bucket[index] = bucket.back();
+  }
+  bucket.pop_back();
+}
+
+}  // namespace
+
+void ShapeSet::Remove(ShapeHandle handle) {
+  switch (handle.kind) {
+    case ShapeKind::kPoint:
+      SwapAndPop(Bucket<Point>(), handle.index);
+      break;
+    case ShapeKind::kSegment:
+      SwapAndPop(Bucket<Segment>(), handle.index);
+      break;
+    case ShapeKind::kLine:
+      SwapAndPop(Bucket<Line>(), handle.index);
+      break;
+    case ShapeKind::kRay:
+      SwapAndPop(Bucket<Ray>(), handle.index);
+      break;
+    case ShapeKind::kCircle:
+      SwapAndPop(Bucket<Circle>(), handle.index);
+      break;
+    case ShapeKind::kPolygon:
+      throw std::invalid_argument("ShapeSet::Remove: unknown shape kind");
+  }
+}
+
+void ShapeSet::Move(ShapeHandle handle, const Vector& vector) {
+  switch (handle.kind) {
+    case ShapeKind::kPoint:
+      Bucket<Point>().at(handle.index).Point::Move(vector);
+      break;
+    case ShapeKind::kSegment:
+      Bucket<Segment>().at(handle.index).Segment::Move(vector);
+      break;
+    case ShapeKind::kLine:
+      Bucket<Line>().at(handle.index).Line::Move(vector);
+      break;
+    case ShapeKind::kRay:
+      Bucket<Ray>().at(handle.index).Ray::Move(vector);
+      break;
+    case ShapeKind::kCircle:
+      Bucket<Circle>().at(handle.index).Circle::Move(vector);
+      break;
+    case ShapeKind::kPolygon:
+      throw std::invalid_argument("ShapeSet::Move: unknown shape kind");
+  }
+}
+
+void ShapeSet::Move(const Vector& vector) {
+  std::apply(
+      [&vector](auto&... bucket) {
+        auto move_all = [&vector](auto& shapes) {
+          using Shape = typename std::decay_t<decltype(shapes)>::value_type;
+          for (Shape& shape : shapes) {
+            shape.Shape::Move(vector);
+          }
+        };
+        (move_all(bucket), ...);
+      },
+      buckets_);
+}
+
+std::vector<ShapeHandle> ShapeSet::QueryContains(const Point& point) const {
+  std::vector<ShapeHandle> result;
+  ForEach([&](const auto& shape, ShapeHandle handle) {
+    using Shape = std::decay_t<decltype(shape)>;
+    if (shape.Shape::ContainsPoint(point)) {
+      result.push_back(handle);
+    }
+  });
+  return result;
+}
+
+std::vector<ShapeHandle> ShapeSet::QueryCrossing(
+    const Segment& segment) const {
+  std::vector<ShapeHandle> result;
+  ForEach([&](const auto& shape, ShapeHandle handle) {
+    using Shape = std::decay_t<decltype(shape)>;
+    if (shape.Shape::CrossSegment(segment)) {
+      result.push_back(handle);
+    }
+  });
+  return result;
+}
+
+size_t ShapeSet::Size() const {
+  return std::apply(
+      [](const auto&... bucket) { return (bucket.size() + ...); }, buckets_);
+}
+
+void ShapeSet::Clear() {
+  std::apply([](auto&... bucket) { (bucket.clear(), ...); }, buckets_);
+}
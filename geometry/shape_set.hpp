@@ -0,0 +1,144 @@
+#pragma once
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+#include "geometry.hpp"
+
+// Shapes held by value. The alternatives follow ShapeKind, so index() of a
+// variant is its kind. Copying one is the allocation-free clone. Polygon
+// owns heap storage and has no alternative.
+using ShapeVariant = std::variant<Point, Segment, Line, Ray, Circle>;
+
+template <typename Shape>
+constexpr ShapeKind kShapeKind = ShapeKind::kPoint;
+
+template <>
+constexpr ShapeKind kShapeKind<Segment> = ShapeKind::kSegment;
+
+template <>
+constexpr ShapeKind kShapeKind<Line> = ShapeKind::kLine;
+
+template <>
+constexpr ShapeKind kShapeKind<Ray> = ShapeKind::kRay;
+
+template <>
+constexpr ShapeKind kShapeKind<Circle> = ShapeKind::kCircle;
+
+inline ShapeKind KindOf(const ShapeVariant& shape) {
+  return static_cast<ShapeKind>(shape.index());
+}
+
+ShapeVariant ToVariant(const IShape& shape);
+
+inline const IShape& AsShape(const ShapeVariant& shape) {
+  return std::visit([](const auto& alt) -> const IShape& { return alt; },
+                    shape);
+}
+
+// The operations below call the overrides by qualified name, which binds
+// them statically: visitation replaces the vtable.
+inline void MoveShape(ShapeVariant& shape, const Vector& vector) {
+  std::visit(
+      [&vector](auto& alt) {
+        using Shape = std::decay_t<decltype(alt)>;
+        alt.Shape::Move(vector);
+      },
+      shape);
+}
+
+inline bool ContainsPoint(const ShapeVariant& shape, const Point& point) {
+  return std::visit(
+      [&point](const auto& alt) {
+        using Shape = std::decay_t<decltype(alt)>;
+        return alt.Shape::ContainsPoint(point);
+      },
+      shape);
+}
+
+inline bool CrossSegment(const ShapeVariant& shape, const Segment& segment) {
+  return std::visit(
+      [&segment](const auto& alt) {
+        using Shape = std::decay_t<decltype(alt)>;
+        return alt.Shape::CrossSegment(segment);
+      },
+      shape);
+}
+
+inline BoundingBox GetBoundingBox(const ShapeVariant& shape) {
+  return std::visit(
+      [](const auto& alt) {
+        using Shape = std::decay_t<decltype(alt)>;
+        return alt.Shape::GetBoundingBox();
+      },
+      shape);
+}
+
+struct ShapeHandle {
+  ShapeKind kind;
+  size_t index;
+
+  bool operator==(const ShapeHandle& other) const {
+    return kind == other.kind && index == other.index;
+  }
+};
+
+// Shapes bucketed by type into contiguous arrays. Bulk operations run one
+// tight loop per bucket with statically bound calls. Handles stay valid
+// until a Remove of the same kind.
+class ShapeSet {
+ public:
+  ShapeHandle Add(const ShapeVariant& shape);
+
+  ShapeHandle Add(const IShape& shape) { return Add(ToVariant(shape)); }
+
+  ShapeVariant Get(ShapeHandle handle) const;
+
+  // The last shape of the same kind takes over the removed one's index.
+  void Remove(ShapeHandle handle);
+
+  void Move(ShapeHandle handle, const Vector& vector);
+
+  void Move(const Vector& vector);
+
+  std::vector<ShapeHandle> QueryContains(const Point& point) const;
+
+  std::vector<ShapeHandle> QueryCrossing(const Segment& segment) const;
+
+  // func(shape, handle) for every shape, bucket by bucket, with 'shape' of
+  // its concrete type.
+  template <typename Func>
+  void ForEach(Func func) const {
+    std::apply(
+        [&func](const auto&... bucket) { (VisitBucket(bucket, func), ...); },
+        buckets_);
+  }
+
+  template <typename Shape>
+  const std::vector<Shape>& Bucket() const {
+    return std::get<std::vector<Shape>>(buckets_);
+  }
+
+  size_t Size() const;
+
+  void Clear();
+
+ private:
+  template <typename Shape, typename Func>
+  static void VisitBucket(const std::vector<Shape>& bucket, Func& func) {
+    for (size_t i = 0; i < bucket.size(); ++i) {
+      func(bucket[i], ShapeHandle{kShapeKind<Shape>, i});
+    }
+  }
+
+  template <typename Shape>
+  std::vector<Shape>& Bucket() {
+    return std::get<std::vector<Shape>>(buckets_);
+  }
+
+  std::tuple<std::vector<Point>, std::vector<Segment>, std::vector<Line>,
+             std::vector<Ray>, std::vector<Circle>>
+      buckets_;
+};
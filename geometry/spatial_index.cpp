@@ -0,0 +1,180 @@
+#include "spatial_index.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+// floor(numerator / denominator), denominator not zero.
+__int128 FloorDiv(__int128 numerator, __int128 denominator) {
+  __int128 quotient = numerator / denominator;
+  if (numerator % denominator != 0 &&
+      (numerator < 0) != (denominator < 0)) {
+    --quotient;
+  }
+  return quotient;
+}
+
+}  // namespace
+
+ShapeGrid::ShapeGrid(int64_t cell_size) : cell_size_(cell_size) {
+  if (cell_size_ <= 0) {
+    throw std::invalid_argument("ShapeGrid: cell size must be positive");
+  }
+}
+
+int64_t ShapeGrid::CellOf(int64_t coord) const {
+  int64_t cell = coord / cell_size_;
+  return (coord % cell_size_ < 0) ? cell - 1 : cell;
+}
+
+size_t ShapeGrid::Insert(const IShape* shape) {
+  size_t id = entries_.size();
+  if (free_ids_.empty()) {
+    entries_.emplace_back();
+  } else {
+    id = free_ids_.back();
+    free_ids_.pop_back();
+  }
+  Entry& entry = entries_[id];
+  entry.shape = shape;
+  BoundingBox bounds = shape->GetBoundingBox();
+  entry.large = !bounds.IsFinite();
+  if (!entry.large) {
+    entry.min_cell = {CellOf(bounds.min_x), CellOf(bounds.min_y)};
+    entry.max_cell = {CellOf(bounds.max_x), CellOf(bounds.max_y)};
+    uint64_t columns = static_cast<uint64_t>(entry.max_cell.column) -
+                       static_cast<uint64_t>(entry.min_cell.column) + 1;
+    uint64_t rows = static_cast<uint64_t>(entry.max_cell.row) -
+                    static_cast<uint64_t>(entry.min_cell.row) + 1;
+    entry.large = columns > kMaxCellsPerShape || rows > kMaxCellsPerShape ||
+                  columns * rows > kMaxCellsPerShape;
+  }
+  if (entry.large) {
+    large_.push_back(id);
+  } else {
+    for (int64_t row = entry.min_cell.row; row <= entry.max_cell.row; ++row) {
+      for (int64_t column = entry.min_cell.column;
+           column <= entry.max_cell.column; ++column) {
+        cells_[Cell{column, row}].push_back(id);
+      }
+    }
+  }
+  ++size_;
+  return id;
+}
+
+bool ShapeGrid::Remove(size_t id) {
+  if (id >= entries_.size() || entries_[id].shape == nullptr) {
+    return false;
+  }
+  Entry& entry = entries_[id];
+  auto erase_id = [id](std::vector<size_t>& ids) {
+    auto found = std::find(ids.begin(), ids.end(), id);
+    *found = ids.back();
+    ids.pop_back();
+  };
+  if (entry.large) {
+    erase_id(large_);
+  } else {
+    for (int64_t row = entry.min_cell.row; row <= entry.max_cell.row; ++row) {
+      for (int64_t column = entry.min_cell.column;
+           column <= entry.max_cell.column; ++column) {
+        auto cell = cells_.find(Cell{column, row});
+        erase_id(cell->second);
+        if (cell->second.empty()) {
+          cells_.erase(cell);
+        }
+      }
+    }
+  }
+  entry = Entry();
+  free_ids_.push_back(id);
+  --size_;
+  return true;
+}
+
+void ShapeGrid::Collect(const Cell& cell, std::vector<size_t>& ids) const {
+  auto found = cells_.find(cell);
+  if (found != cells_.end()) {
+    ids.insert(ids.end(), found->second.begin(), found->second.end());
+  }
+}
+
+std::vector<const IShape*> ShapeGrid::QueryContains(const Point& point) const {
+  std::vector<size_t> ids = large_;
+  Collect(Cell{CellOf(point.GetX()), CellOf(point.GetY())}, ids);
+  std::vector<const IShape*> result;
+  for (size_t id : ids) {
+    if (entries_[id].shape->ContainsPoint(point)) {
+      result.push_back(entries_[id].shape);
+    }
+  }
+  return result;
+}
+
+std::vector<const IShape*> ShapeGrid::QueryCrossing(
+    const Segment& segment) const {
+  Point begin = segment.GetA();
+  Point end = segment.GetB();
+  Cell min_cell{CellOf(std::min(begin.GetX(), end.GetX())),
+                CellOf(std::min(begin.GetY(), end.GetY()))};
+  Cell max_cell{CellOf(std::max(begin.GetX(), end.GetX())),
+                CellOf(std::max(begin.GetY(), end.GetY()))};
+  std::vector<size_t> ids = large_;
+  uint64_t columns = static_cast<uint64_t>(max_cell.column) -
+                     static_cast<uint64_t>(min_cell.column) + 1;
+  uint64_t rows = static_cast<uint64_t>(max_cell.row) -
+                  static_cast<uint64_t>(min_cell.row) + 1;
+  if (columns > cells_.size() || rows > cells_.size()) {
+    // Walking the rows would visit more cells than are occupied.
+    for (const auto& [cell, cell_ids] : cells_) {
+      if (cell.column >= min_cell.column && cell.column <= max_cell.column &&
+          cell.row >= min_cell.row && cell.row <= max_cell.row) {
+        ids.insert(ids.end(), cell_ids.begin(), cell_ids.end());
+      }
+    }
+  } else {
+    // Per row, the columns the segment passes through: the floors of
+    // x = x0 + (y - y0) * dx / dy where it enters and leaves the row, both
+    // edges included. The products stay below 2^126 while |dx| and |dy|
+    // are below 2^63; past that every row keeps all columns.
+    __int128 x0 = begin.GetX();
+    __int128 y0 = begin.GetY();
+    __int128 dx = __int128{end.GetX()} - x0;
+    __int128 dy = __int128{end.GetY()} - y0;
+    __int128 min_y = std::min(begin.GetY(), end.GetY());
+    __int128 max_y = std::max(begin.GetY(), end.GetY());
+    const __int128 kLimit = __int128{1} << 63;
+    bool narrow = dy != 0 && dx < kLimit && -dx < kLimit && dy < kLimit &&
+                  -dy < kLimit;
+    for (int64_t row = min_cell.row; row <= max_cell.row; ++row) {
+      int64_t first = min_cell.column;
+      int64_t last = max_cell.column;
+      if (narrow) {
+        __int128 low = std::max(__int128{row} * cell_size_, min_y);
+        __int128 high = std::min((__int128{row} + 1) * cell_size_, max_y);
+        __int128 xa = x0 + FloorDiv((low - y0) * dx, dy);
+        __int128 xb = x0 + FloorDiv((high - y0) * dx, dy);
+        first = std::max<int64_t>(
+            first, static_cast<int64_t>(
+                       FloorDiv(std::min(xa, xb), cell_size_)));
+        last = std::min<int64_t>(
+            last, static_cast<int64_t>(
+                      FloorDiv(std::max(xa, xb), cell_size_)));
+      }
+      for (int64_t column = first; column <= last; ++column) {
+        Collect(Cell{column, row}, ids);
+      }
+    }
+  }
+  std::sort(ids.begin(), ids.end());
+  ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+  std::vector<const IShape*> result;
+  for (size_t id : ids) {
+    if (entries_[id].shape->CrossSegment(segment)) {
+      result.push_back(entries_[id].shape);
+    }
+  }
+  return result;
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "geometry.hpp"
+
+// Uniform grid over shapes owned by the caller. A shape is registered in
+// every cell its bounding box touches; queries gather candidates from the
+// cells they touch and refine them with the exact ContainsPoint and
+// CrossSegment predicates. Shapes without a finite box (Line, Ray) and
+// shapes spanning too many cells live in a separate list that every query
+// checks. Indexed shapes must not be moved: Remove and Insert them again.
+class ShapeGrid {
+ public:
+  explicit ShapeGrid(int64_t cell_size = 64);
+
+  // Returns an id for Remove. Ids of removed shapes are reused.
+  size_t Insert(const IShape* shape);
+
+  // Returns false if the id is not in the index.
+  bool Remove(size_t id);
+
+  std::vector<const IShape*> QueryContains(const Point& point) const;
+
+  std::vector<const IShape*> QueryCrossing(const Segment& segment) const;
+
+  size_t Size() const { return size_; }
+
+ private:
+  struct Cell {
+    int64_t column;
+    int64_t row;
+
+    bool operator==(const Cell& other) const {
+      return column == other.column && row == other.row;
+    }
+  };
+
+  struct CellHash {
+    size_t operator()(const Cell& cell) const {
+      uint64_t hash = static_cast<uint64_t>(cell.column) * 0x9E3779B97F4A7C15;
+      return hash ^ (static_cast<uint64_t>(cell.row) + (hash >> 29));
+    }
+  };
+
+  struct Entry {
+    const IShape* shape = nullptr;
+    bool large = false;
+    Cell min_cell{0, 0};
+    Cell max_cell{0, 0};
+  };
+
+  // A shape spanning more cells than this goes to the large list.
+  static const int64_t kMaxCellsPerShape = 1024;
+
+  int64_t CellOf(int64_t coord) const;
+
+  void Collect(const Cell& cell, std::vector<size_t>& ids) const;
+
+  int64_t cell_size_;
+  size_t size_ = 0;
+  std::unordered_map<Cell, std::vector<size_t>, CellHash> cells_;
+  std::vector<Entry> entries_;
+  std::vector<size_t> free_ids_;
+  std::vector<size_t> large_;
+};
@@ -0,0 +1,227 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <utility>
+
+#include "deque.hpp"
+
+// Windowed aggregation over event streams. Every aggregator exposes the
+// same interface (push, evict, query, size, empty), so the eviction
+// policies below can wrap any of them. push and evict are amortized O(1).
+
+template <typename T>
+struct SumMonoid {
+  T identity() const { return T(); }
+
+  T operator()(const T& left, const T& right) const { return left + right; }
+};
+
+template <typename T>
+struct MinMonoid {
+  T identity() const { return std::numeric_limits<T>::max(); }
+
+  T operator()(const T& left, const T& right) const {
+    return right < left ? right : left;
+  }
+};
+
+template <typename T>
+struct MaxMonoid {
+  T identity() const { return std::numeric_limits<T>::lowest(); }
+
+  T operator()(const T& left, const T& right) const {
+    return left < right ? right : left;
+  }
+};
+
+// Extremum of the window by Compare: the minimum for std::less, the
+// maximum for std::greater. Keeps only elements that can still become
+// the answer, so query() is O(1).
+template <typename T, typename Compare = std::less<T>>
+class MonotonicWindow {
+ private:
+  Deque<std::pair<uint64_t, T>> candidates_;
+  uint64_t pushed_ = 0;
+  uint64_t evicted_ = 0;
+  Compare comp_;
+
+ public:
+  MonotonicWindow(const Compare& comp = Compare()) : comp_(comp) {}
+
+  void push(const T& value) {
+    while (!candidates_.empty() &&
+           !comp_(candidates_[candidates_.size() - 1].second, value)) {
+      candidates_.pop_back();
+    }
+    candidates_.push_back(std::make_pair(pushed_++, value));
+  }
+
+  template <typename Iterator>
+  void push(Iterator first, Iterator last) {
+    for (; first != last; ++first) {
+      push(*first);
+    }
+  }
+
+  // Evicts the 'count' oldest elements of the window.
+  void evict(size_t count = 1) {
+    evicted_ += std::min<uint64_t>(count, size());
+    while (!candidates_.empty() && candidates_[0].first < evicted_) {
+      candidates_.pop_front();
+    }
+  }
+
+  // Undefined on an empty window.
+  const T& query() const { return candidates_[0].second; }
+
+  size_t size() const { return pushed_ - evicted_; }
+
+  bool empty() const { return pushed_ == evicted_; }
+};
+
+// Aggregation by an arbitrary associative Monoid, which need not be
+// invertible or commutative. The front stack holds suffix aggregates of
+// the older elements, the back stack holds raw newer elements plus their
+// running aggregate; the front is rebuilt from the back when it runs dry.
+template <typename T, typename Monoid = SumMonoid<T>>
+class TwoStackAggregator {
+ private:
+  Deque<T> front_;
+  Deque<T> back_;
+  T back_agg_;
+  Monoid monoid_;
+
+  void flip() {
+    T agg = monoid_.identity();
+    for (size_t i = back_.size(); i-- > 0;) {
+      agg = monoid_(back_[i], agg);
+      front_.push_back(agg);
+    }
+    // Popping keeps the buckets for reuse, unlike assigning a new deque.
+    while (!back_.empty()) {
+      back_.pop_back();
+    }
+    back_agg_ = monoid_.identity();
+  }
+
+ public:
+  TwoStackAggregator(const Monoid& monoid = Monoid())
+      : back_agg_(monoid.identity()), monoid_(monoid) {}
+
+  void push(const T& value) {
+    back_.push_back(value);
+    back_agg_ = monoid_(back_agg_, value);
+  }
+
+  template <typename Iterator>
+  void push(Iterator first, Iterator last) {
+    for (; first != last; ++first) {
+      push(*first);
+    }
+  }
+
+  void evict(size_t count = 1) {
+    for (; count != 0 && !empty(); --count) {
+      if (front_.empty()) {
+        flip();
+      }
+      front_.pop_back();
+    }
+  }
+
+  // Identity of the monoid on an empty window.
+  T query() const {
+    if (front_.empty()) {
+      return back_agg_;
+    }
+    return monoid_(front_[front_.size() - 1], back_agg_);
+  }
+
+  size_t size() const { return front_.size() + back_.size(); }
+
+  bool empty() const { return front_.empty() && back_.empty(); }
+};
+
+// Keeps at most 'capacity' latest elements of the stream.
+template <typename Aggregator>
+class CountWindow {
+ private:
+  Aggregator aggregator_;
+  size_t capacity_;
+
+ public:
+  CountWindow(size_t capacity, const Aggregator& aggregator = Aggregator())
+      : aggregator_(aggregator), capacity_(capacity) {}
+
+  template <typename Value>
+  void push(const Value& value) {
+    aggregator_.push(value);
+    if (aggregator_.size() > capacity_) {
+      aggregator_.evict(aggregator_.size() - capacity_);
+    }
+  }
+
+  // Batch advance: pushes the whole range, evicting once at the end.
+  template <typename Iterator>
+  void push(Iterator first, Iterator last) {
+    aggregator_.push(first, last);
+    if (aggregator_.size() > capacity_) {
+      aggregator_.evict(aggregator_.size() - capacity_);
+    }
+  }
+
+  auto query() const { return aggregator_.query(); }
+
+  size_t size() const { return aggregator_.size(); }
+
+  bool empty() const { return aggregator_.empty(); }
+};
+
+// Keeps elements stamped within (now - span, now]. Timestamps must be
+// pushed in non-decreasing order.
+template <typename Aggregator, typename Time = int64_t>
+class TimeWindow {
+ private:
+  Aggregator aggregator_;
+  Deque<Time> stamps_;
+  Time span_;
+
+ public:
+  TimeWindow(Time span, const Aggregator& aggregator = Aggregator())
+      : aggregator_(aggregator), span_(span) {}
+
+  template <typename Value>
+  void push(Time now, const Value& value) {
+    advance(now);
+    aggregator_.push(value);
+    stamps_.push_back(now);
+  }
+
+  // Batch advance: all values of the range share the timestamp 'now'.
+  template <typename Iterator>
+  void push(Time now, Iterator first, Iterator last) {
+    advance(now);
+    for (; first != last; ++first) {
+      aggregator_.push(*first);
+      stamps_.push_back(now);
+    }
+  }
+
+  // Evicts everything that fell out of the window by time 'now'.
+  void advance(Time now) {
+    size_t expired = 0;
+    while (!stamps_.empty() && !(now - span_ < stamps_[0])) {
+      stamps_.pop_front();
+      ++expired;
+    }
+    aggregator_.evict(expired);
+  }
+
+  auto query() const { return aggregator_.query(); }
+
+  size_t size() const { return aggregator_.size(); }
+
+  bool empty() const { return aggregator_.empty(); }
+};